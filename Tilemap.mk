@@ -13,5 +13,16 @@ UINCDIR := $(call uniq, $(UINCDIR) $(_RELATIVE_DIR))
 
 # -- Add our source files
 SRC := $(SRC) \
+	   $(_RELATIVE_DIR)/Tilemap/Arena.c \
+	   $(_RELATIVE_DIR)/Tilemap/Autotile.c \
+	   $(_RELATIVE_DIR)/Tilemap/Blitter.c \
+	   $(_RELATIVE_DIR)/Tilemap/Collision.c \
+	   $(_RELATIVE_DIR)/Tilemap/MapFile.c \
+	   $(_RELATIVE_DIR)/Tilemap/Occupancy.c \
 	   $(_RELATIVE_DIR)/Tilemap/OldCTilemap.c \
-	   $(_RELATIVE_DIR)/Tilemap/Tilemap.c
+	   $(_RELATIVE_DIR)/Tilemap/Pathfinding.c \
+	   $(_RELATIVE_DIR)/Tilemap/TileStorage.c \
+	   $(_RELATIVE_DIR)/Tilemap/Tileset.c \
+	   $(_RELATIVE_DIR)/Tilemap/Tilemap.c \
+	   $(_RELATIVE_DIR)/Tilemap/TilemapArena.c \
+	   $(_RELATIVE_DIR)/Tilemap/TilemapLayers.c
@@ -0,0 +1,165 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#include "Tilemap/Arena.h"
+
+#define DM_LOG_ENABLE
+#include "pdbase/pdbase.h"
+
+#include <string.h>
+
+// -- Every allocation is preceded by a header holding its size and is rounded up so the next one stays aligned.
+#define ARENA_ALIGNMENT     8
+#define ARENA_HEADER_SIZE   ARENA_ALIGNMENT
+
+// -- A freed block reuses its allocation's memory to link to the next free block.
+typedef struct ArenaFreeBlock {
+    struct ArenaFreeBlock* next;
+} ArenaFreeBlock;
+
+static inline size_t arenaBlockSize(const void* pointer)
+{
+    size_t size;
+    memcpy(&size, (const uint8_t*)pointer - ARENA_HEADER_SIZE, sizeof(size_t));
+
+    return size;
+}
+
+// -- Allocate an arena of size bytes. Returns NULL on error.
+Arena* arenaNew(size_t size)
+{
+    Arena* this = dmMemoryCalloc(1, sizeof(Arena));
+    if (this == NULL) {
+        return NULL;
+    }
+
+    this->memory = dmMemoryCalloc(size, sizeof(uint8_t));
+    if (this->memory == NULL) {
+        DM_LOG("Arena: Error allocating %d bytes.", (int)size);
+        dmMemoryFree(this);
+        return NULL;
+    }
+
+    this->size = size;
+
+    return this;
+}
+
+void arenaDelete(Arena* this)
+{
+    dmMemoryFree(this->users);
+    dmMemoryFree(this->memory);
+    dmMemoryFree(this);
+}
+
+// -- Release every allocation at once, after letting each user know.
+void arenaReset(Arena* this)
+{
+    for (int i = 0; i < this->nb_of_users; ++i) {
+        this->users[i].reset(this->users[i].owner);
+    }
+
+    this->used = 0;
+    this->free_blocks = NULL;
+}
+
+// -- Register owner to be told when the arena is reset. Returns 0 on error.
+int arenaAddUser(Arena* this, void* owner, ArenaResetFunction reset)
+{
+    if (this->nb_of_users == this->users_capacity) {
+        int capacity = (this->users_capacity != 0) ? this->users_capacity * 2 : 8;
+
+        ArenaUser* users = dmMemoryCalloc(capacity, sizeof(ArenaUser));
+        if (users == NULL) {
+            DM_LOG("Arena: Error allocating %d users.", capacity);
+            return 0;
+        }
+
+        if (this->users != NULL) {
+            memcpy(users, this->users, this->nb_of_users * sizeof(ArenaUser));
+            dmMemoryFree(this->users);
+        }
+
+        this->users = users;
+        this->users_capacity = capacity;
+    }
+
+    this->users[this->nb_of_users].owner = owner;
+    this->users[this->nb_of_users].reset = reset;
+    ++this->nb_of_users;
+
+    return 1;
+}
+
+void arenaRemoveUser(Arena* this, void* owner)
+{
+    for (int i = 0; i < this->nb_of_users; ++i) {
+        if (this->users[i].owner == owner) {
+            this->users[i] = this->users[--this->nb_of_users];
+            return;
+        }
+    }
+}
+
+// -- Allocate zeroed memory for nb_of_items items of item_size bytes. Freed blocks between that size and twice
+// -- it are reused before carving new memory. Returns NULL if the arena is full.
+void* arenaCalloc(Arena* this, size_t nb_of_items, size_t item_size)
+{
+    if (this == NULL) {
+        return dmMemoryCalloc(nb_of_items, item_size);
+    }
+
+    size_t size = nb_of_items * item_size;
+    if (size < sizeof(ArenaFreeBlock)) {
+        size = sizeof(ArenaFreeBlock);
+    }
+
+    size = (size + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    for (ArenaFreeBlock** current = (ArenaFreeBlock**)&this->free_blocks; *current != NULL; current = &(*current)->next) {
+        size_t block_size = arenaBlockSize(*current);
+        if ((block_size >= size) && (block_size <= (size * 2))) {
+            void* pointer = *current;
+            *current = (*current)->next;
+
+            memset(pointer, 0, block_size);
+            return pointer;
+        }
+    }
+
+    if ((this->used + ARENA_HEADER_SIZE + size) > this->size) {
+        DM_LOG("Arena: Out of memory allocating %d bytes (%d of %d used).", (int)size, (int)this->used, (int)this->size);
+        return NULL;
+    }
+
+    uint8_t* block = this->memory + this->used;
+    memcpy(block, &size, sizeof(size_t));
+
+    this->used += ARENA_HEADER_SIZE + size;
+    if (this->used > this->high_water_mark) {
+        this->high_water_mark = this->used;
+    }
+
+    uint8_t* pointer = block + ARENA_HEADER_SIZE;
+    memset(pointer, 0, size);
+
+    return pointer;
+}
+
+// -- Give an allocation back so it can be reused before the arena is reset.
+void arenaFree(Arena* this, void* pointer)
+{
+    if (this == NULL) {
+        dmMemoryFree(pointer);
+        return;
+    }
+
+    if (pointer == NULL) {
+        return;
+    }
+
+    ArenaFreeBlock* block = pointer;
+    block->next = this->free_blocks;
+    this->free_blocks = block;
+}
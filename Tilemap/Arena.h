@@ -0,0 +1,43 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef DM_ARENA_H
+#define DM_ARENA_H
+
+#include "pd_api.h"
+
+// -- Called when the arena is reset, so that owner forgets everything it allocated in it.
+typedef void (*ArenaResetFunction)(void* owner);
+
+typedef struct {
+    void* owner;
+    ArenaResetFunction reset;
+} ArenaUser;
+
+// -- A fixed block of memory that allocations are carved from, all released at once by arenaReset(). Freed
+// -- allocations are kept in a list and reused by later allocations of a similar size.
+typedef struct {
+    uint8_t* memory;
+    size_t size;
+
+    size_t used;
+    size_t high_water_mark;
+    void* free_blocks;
+
+    int nb_of_users;
+    int users_capacity;
+    ArenaUser* users;
+} Arena;
+
+extern Arena* arenaNew(size_t size);
+extern void arenaDelete(Arena* this);
+extern void arenaReset(Arena* this);
+extern int arenaAddUser(Arena* this, void* owner, ArenaResetFunction reset);
+extern void arenaRemoveUser(Arena* this, void* owner);
+
+// -- Both fall back to the heap if arena is NULL.
+extern void* arenaCalloc(Arena* this, size_t nb_of_items, size_t item_size);
+extern void arenaFree(Arena* this, void* pointer);
+
+#endif
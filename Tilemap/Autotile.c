@@ -0,0 +1,197 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#include "Tilemap/Autotile.h"
+
+#define DM_LOG_ENABLE
+#include "pdbase/pdbase.h"
+
+#include <string.h>
+
+// -- Neighbour offsets, in the order of their bits in a neighbour mask.
+static const int autotileOffsets[8][2] = {
+    { 0, -1 }, { 1, 0 }, { 0, 1 }, { -1, 0 },
+    { 1, -1 }, { 1, 1 }, { -1, 1 }, { -1, -1 }
+};
+
+// -- Clear the corners of mask whose two sides are not both set.
+static inline int autotileReduceMask(int mask)
+{
+    if ((mask & (AUTOTILE_NORTH | AUTOTILE_EAST)) != (AUTOTILE_NORTH | AUTOTILE_EAST)) {
+        mask &= ~AUTOTILE_NORTH_EAST;
+    }
+
+    if ((mask & (AUTOTILE_SOUTH | AUTOTILE_EAST)) != (AUTOTILE_SOUTH | AUTOTILE_EAST)) {
+        mask &= ~AUTOTILE_SOUTH_EAST;
+    }
+
+    if ((mask & (AUTOTILE_SOUTH | AUTOTILE_WEST)) != (AUTOTILE_SOUTH | AUTOTILE_WEST)) {
+        mask &= ~AUTOTILE_SOUTH_WEST;
+    }
+
+    if ((mask & (AUTOTILE_NORTH | AUTOTILE_WEST)) != (AUTOTILE_NORTH | AUTOTILE_WEST)) {
+        mask &= ~AUTOTILE_NORTH_WEST;
+    }
+
+    return mask;
+}
+
+// -- Free every chunk of terrain and the chunk table.
+static void autotileFreeChunks(Autotile* this)
+{
+    if (this->chunks == NULL) {
+        return;
+    }
+
+    for (int index = 0; index < (this->chunks_wide * this->chunks_high); ++index) {
+        arenaFree(this->arena, this->chunks[index]);
+    }
+
+    arenaFree(this->arena, this->chunks);
+    this->chunks = NULL;
+}
+
+// -- Allocate autotiling for a map, in arena or on the heap if arena is NULL. No terrain has rules yet.
+Autotile* autotileNew(Arena* arena)
+{
+    Autotile* this = arenaCalloc(arena, 1, sizeof(Autotile));
+    if (this == NULL) {
+        return NULL;
+    }
+
+    this->arena = arena;
+
+    return this;
+}
+
+void autotileDelete(Autotile* this)
+{
+    autotileFreeChunks(this);
+
+    for (int index = 0; index < AUTOTILE_MAX_TERRAINS; ++index) {
+        arenaFree(this->arena, this->rules[index]);
+    }
+
+    Arena* arena = this->arena;
+    arenaFree(arena, this);
+}
+
+// -- Paint terrains over map from now on. Every cell starts off without a terrain, the rules are kept.
+void autotileSetMap(Autotile* this, const TileStorage* map)
+{
+    autotileFreeChunks(this);
+
+    this->width = (map != NULL) ? map->width : 0;
+    this->height = (map != NULL) ? map->height : 0;
+
+    this->chunks_wide = (this->width + TILE_STORAGE_CHUNK_MASK) >> TILE_STORAGE_CHUNK_SHIFT;
+    this->chunks_high = (this->height + TILE_STORAGE_CHUNK_MASK) >> TILE_STORAGE_CHUNK_SHIFT;
+}
+
+// -- Set the rules for terrain, from 1 to AUTOTILE_MAX_TERRAINS. With AUTOTILE_NB_OF_FOUR_BIT_TILES tiles,
+// -- tiles[mask] is used for four-bit neighbour mask mask. With AUTOTILE_NB_OF_BLOB_TILES tiles, they are used for
+// -- the blob masks in increasing order. Returns 0 on error.
+int autotileSetRules(Autotile* this, int terrain, const uint16_t* tiles, int nb_of_tiles)
+{
+    if ((terrain < 1) || (terrain > AUTOTILE_MAX_TERRAINS) ||
+        ((nb_of_tiles != AUTOTILE_NB_OF_FOUR_BIT_TILES) && (nb_of_tiles != AUTOTILE_NB_OF_BLOB_TILES))) {
+        return 0;
+    }
+
+    AutotileRules* rules = this->rules[terrain - 1];
+    if (rules == NULL) {
+        rules = arenaCalloc(this->arena, 1, sizeof(AutotileRules));
+        if (rules == NULL) {
+            DM_LOG("Autotile: Error allocating rules for terrain %d.", terrain);
+            return 0;
+        }
+
+        this->rules[terrain - 1] = rules;
+    }
+
+    memset(rules->tiles, 0, sizeof(rules->tiles));
+
+    if (nb_of_tiles == AUTOTILE_NB_OF_FOUR_BIT_TILES) {
+        rules->kind = kAutotileFourBit;
+        memcpy(rules->tiles, tiles, nb_of_tiles * sizeof(uint16_t));
+    }
+    else {
+        rules->kind = kAutotileBlob;
+
+        int index = 0;
+        for (int mask = 0; mask < AUTOTILE_NB_OF_MASKS; ++mask) {
+            if (autotileReduceMask(mask) == mask) {
+                rules->tiles[mask] = tiles[index++];
+            }
+        }
+    }
+
+    return 1;
+}
+
+// -- Set the terrain of cell (x, y), 0-based, without changing any tile. Returns 0 on error.
+int autotileSetTerrain(Autotile* this, int x, int y, int terrain)
+{
+    // -- Cells in chunks that aren't allocated have no terrain already.
+    if (this->chunks == NULL) {
+        if (terrain == 0) {
+            return 1;
+        }
+
+        this->chunks = arenaCalloc(this->arena, this->chunks_wide * this->chunks_high, sizeof(uint8_t*));
+        if (this->chunks == NULL) {
+            DM_LOG("Autotile: Error allocating terrain chunks for %dx%d cells.", this->width, this->height);
+            return 0;
+        }
+    }
+
+    uint8_t** chunk = &this->chunks[((y >> TILE_STORAGE_CHUNK_SHIFT) * this->chunks_wide) + (x >> TILE_STORAGE_CHUNK_SHIFT)];
+    if (*chunk == NULL) {
+        if (terrain == 0) {
+            return 1;
+        }
+
+        *chunk = arenaCalloc(this->arena, TILE_STORAGE_CHUNK_SIZE * TILE_STORAGE_CHUNK_SIZE, sizeof(uint8_t));
+        if (*chunk == NULL) {
+            DM_LOG("Autotile: Error allocating terrains for cell %d,%d.", x, y);
+            return 0;
+        }
+    }
+
+    (*chunk)[((y & TILE_STORAGE_CHUNK_MASK) << TILE_STORAGE_CHUNK_SHIFT) + (x & TILE_STORAGE_CHUNK_MASK)] = (uint8_t)terrain;
+
+    return 1;
+}
+
+// -- Find the tile for cell (x, y), 0-based, from the terrain of its neighbours. Returns 0, leaving value unchanged,
+// -- if the cell has no terrain or its terrain has no rules.
+int autotileGetTile(const Autotile* this, int x, int y, uint16_t* value)
+{
+    int terrain = autotileGetTerrain(this, x, y);
+    if (terrain == 0) {
+        return 0;
+    }
+
+    const AutotileRules* rules = this->rules[terrain - 1];
+    if (rules == NULL) {
+        return 0;
+    }
+
+    int nb_of_neighbours = (rules->kind == kAutotileFourBit) ? 4 : 8;
+    int mask = 0;
+
+    for (int neighbour = 0; neighbour < nb_of_neighbours; ++neighbour) {
+        int neighbour_x = x + autotileOffsets[neighbour][0];
+        int neighbour_y = y + autotileOffsets[neighbour][1];
+
+        if ((neighbour_x < 0) || (neighbour_y < 0) || (neighbour_x >= this->width) || (neighbour_y >= this->height) ||
+            (autotileGetTerrain(this, neighbour_x, neighbour_y) == terrain)) {
+            mask |= 1 << neighbour;
+        }
+    }
+
+    *value = rules->tiles[(rules->kind == kAutotileBlob) ? autotileReduceMask(mask) : mask];
+
+    return 1;
+}
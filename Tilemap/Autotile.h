@@ -0,0 +1,84 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef DM_AUTOTILE_H
+#define DM_AUTOTILE_H
+
+#include "pd_api.h"
+
+#include "Tilemap/TileStorage.h"
+
+// -- Constants
+#define AUTOTILE_MAX_TERRAINS 32
+#define AUTOTILE_NB_OF_MASKS 256
+#define AUTOTILE_NB_OF_FOUR_BIT_TILES 16
+#define AUTOTILE_NB_OF_BLOB_TILES 47
+
+// -- Bits of a cell's neighbour mask, set when that neighbour has the same terrain. Four-bit rules only look at the
+// -- first four. Blob rules look at all eight but only count a corner if both sides next to it are set as well,
+// -- which leaves 47 different masks.
+#define AUTOTILE_NORTH          1
+#define AUTOTILE_EAST           2
+#define AUTOTILE_SOUTH          4
+#define AUTOTILE_WEST           8
+#define AUTOTILE_NORTH_EAST     16
+#define AUTOTILE_SOUTH_EAST     32
+#define AUTOTILE_SOUTH_WEST     64
+#define AUTOTILE_NORTH_WEST     128
+
+typedef enum {
+    kAutotileFourBit,
+    kAutotileBlob
+} AutotileKind;
+
+// -- How one terrain is drawn, tiles[mask] is the cell value used for cells whose neighbour mask is mask.
+typedef struct {
+    AutotileKind kind;
+    uint16_t tiles[AUTOTILE_NB_OF_MASKS];
+} AutotileRules;
+
+// -- Terrain painted in each cell of a map and the rules picking a tile for it from its neighbours. Cells outside
+// -- of the map count as having the same terrain.
+typedef struct {
+    Arena* arena;
+
+    int width;
+    int height;
+
+    // -- Terrains are stored in chunks of TILE_STORAGE_CHUNK_SIZE x TILE_STORAGE_CHUNK_SIZE cells like the map, only
+    // -- allocated once a terrain is set in them, so painting a small area of a big map stays cheap. The chunk
+    // -- table itself is allocated the first time a terrain is set.
+    int chunks_wide;
+    int chunks_high;
+    uint8_t** chunks;
+
+    // -- rules[terrain - 1], NULL until rules are set for that terrain.
+    AutotileRules* rules[AUTOTILE_MAX_TERRAINS];
+} Autotile;
+
+extern Autotile* autotileNew(Arena* arena);
+extern void autotileDelete(Autotile* this);
+extern void autotileSetMap(Autotile* this, const TileStorage* map);
+extern int autotileSetRules(Autotile* this, int terrain, const uint16_t* tiles, int nb_of_tiles);
+extern int autotileSetTerrain(Autotile* this, int x, int y, int terrain);
+extern int autotileGetTile(const Autotile* this, int x, int y, uint16_t* value);
+
+// -- Returns the terrains of the chunk at chunk coordinates (chunk_x, chunk_y), or NULL if none are set in it.
+static inline const uint8_t* autotileGetChunk(const Autotile* this, int chunk_x, int chunk_y)
+{
+    return (this->chunks != NULL) ? this->chunks[(chunk_y * this->chunks_wide) + chunk_x] : NULL;
+}
+
+// -- Returns the terrain of cell (x, y), 0-based, or 0 if it has none.
+static inline int autotileGetTerrain(const Autotile* this, int x, int y)
+{
+    const uint8_t* chunk = autotileGetChunk(this, x >> TILE_STORAGE_CHUNK_SHIFT, y >> TILE_STORAGE_CHUNK_SHIFT);
+    if (chunk == NULL) {
+        return 0;
+    }
+
+    return chunk[((y & TILE_STORAGE_CHUNK_MASK) << TILE_STORAGE_CHUNK_SHIFT) + (x & TILE_STORAGE_CHUNK_MASK)];
+}
+
+#endif
@@ -0,0 +1,530 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#include "Tilemap/Blitter.h"
+
+#define DM_LOG_ENABLE
+#include "pdbase/pdbase.h"
+
+#include <string.h>
+
+// -- Number of 32 bit words in a frame buffer row, LCD_ROWSIZE is always a multiple of 4.
+#define BLITTER_FRAME_WORDS (LCD_ROWSIZE / 4)
+
+// -- Read up to 4 bytes as a big endian word so that the leftmost pixel ends up in the most significant bit.
+static inline uint32_t blitterLoad(const uint8_t* bytes, int nb_of_bytes)
+{
+    if (nb_of_bytes >= 4) {
+        return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+    }
+
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value <<= 8;
+        if (i < nb_of_bytes) {
+            value |= bytes[i];
+        }
+    }
+
+    return value;
+}
+
+static inline void blitterStore(uint8_t* bytes, uint32_t value)
+{
+    bytes[0] = (uint8_t)(value >> 24);
+    bytes[1] = (uint8_t)(value >> 16);
+    bytes[2] = (uint8_t)(value >> 8);
+    bytes[3] = (uint8_t)value;
+}
+
+// -- Bits for pixels [from, to[ of a 32 pixel word.
+static inline uint32_t blitterSpanMask(int from, int to)
+{
+    if (from < 0) {
+        from = 0;
+    }
+
+    if (to > 32) {
+        to = 32;
+    }
+
+    if (from >= to) {
+        return 0;
+    }
+
+    uint32_t mask = 0xFFFFFFFFu >> from;
+    if (to < 32) {
+        mask &= ~(0xFFFFFFFFu >> to);
+    }
+
+    return mask;
+}
+
+// -- Merge 32 source pixels into the frame buffer row at pixel position x, where only the pixels in keep are written.
+static inline void blitterMerge(uint8_t* row, int x, uint32_t source, uint32_t keep)
+{
+    int word_index = (x >= 0) ? (x / 32) : -((-x + 31) / 32);
+    int shift = x - (word_index * 32);
+
+    uint32_t first_keep = keep >> shift;
+    if ((first_keep != 0) && (word_index >= 0) && (word_index < BLITTER_FRAME_WORDS)) {
+        uint8_t* bytes = row + (word_index * 4);
+        uint32_t value = blitterLoad(bytes, 4);
+        blitterStore(bytes, (value & ~first_keep) | ((source >> shift) & first_keep));
+    }
+
+    if (shift == 0) {
+        return;
+    }
+
+    uint32_t second_keep = keep << (32 - shift);
+    if ((second_keep != 0) && ((word_index + 1) >= 0) && ((word_index + 1) < BLITTER_FRAME_WORDS)) {
+        uint8_t* bytes = row + ((word_index + 1) * 4);
+        uint32_t value = blitterLoad(bytes, 4);
+        blitterStore(bytes, (value & ~second_keep) | ((source << (32 - shift)) & second_keep));
+    }
+}
+
+// -- Defines a blitter for bitmaps of a fixed size of at most 32 pixels wide, so that each row is a single word
+// -- and the row loop can be unrolled when the bitmap is fully inside the clip rectangle.
+#define BLITTER_DEFINE_NARROW_DRAW(name, WIDTH, HEIGHT, MASKED) \
+static void name(uint8_t* frame, const BlitterBitmap* bitmap, int x, int y, int left, int top, int right, int bottom) \
+{ \
+    int first_row = 0; \
+    int last_row = (HEIGHT); \
+    if (top < 0) { top = 0; } \
+    if (bottom > LCD_ROWS) { bottom = LCD_ROWS; } \
+    if (left < 0) { left = 0; } \
+    if (right > LCD_COLUMNS) { right = LCD_COLUMNS; } \
+    uint32_t keep = blitterSpanMask(0, (WIDTH)) & blitterSpanMask(left - x, right - x); \
+    if (keep == 0) { return; } \
+    const uint8_t* data = bitmap->data; \
+    const uint8_t* mask = bitmap->mask; \
+    int masked = (MASKED) && (mask != NULL); \
+    int rowbytes = bitmap->rowbytes; \
+    uint8_t* row = frame + (y * LCD_ROWSIZE); \
+    if ((y >= top) && ((y + (HEIGHT)) <= bottom)) { \
+        for (int source_y = 0; source_y < (HEIGHT); ++source_y) { \
+            uint32_t row_keep = masked ? (keep & blitterLoad(mask, (WIDTH) / 8)) : keep; \
+            blitterMerge(row, x, blitterLoad(data, (WIDTH) / 8), row_keep); \
+            data += rowbytes; \
+            mask += masked ? rowbytes : 0; \
+            row += LCD_ROWSIZE; \
+        } \
+        return; \
+    } \
+    if (top > y) { first_row = top - y; } \
+    if ((bottom - y) < last_row) { last_row = bottom - y; } \
+    for (int source_y = first_row; source_y < last_row; ++source_y) { \
+        uint32_t row_keep = masked ? (keep & blitterLoad(mask + (source_y * rowbytes), (WIDTH) / 8)) : keep; \
+        blitterMerge(row + (source_y * LCD_ROWSIZE), x, blitterLoad(data + (source_y * rowbytes), (WIDTH) / 8), row_keep); \
+    } \
+}
+
+BLITTER_DEFINE_NARROW_DRAW(blitterDraw8x8, 8, 8, 0)
+BLITTER_DEFINE_NARROW_DRAW(blitterDraw8x8Masked, 8, 8, 1)
+BLITTER_DEFINE_NARROW_DRAW(blitterDraw16x16, 16, 16, 0)
+BLITTER_DEFINE_NARROW_DRAW(blitterDraw16x16Masked, 16, 16, 1)
+BLITTER_DEFINE_NARROW_DRAW(blitterDraw32x32, 32, 32, 0)
+BLITTER_DEFINE_NARROW_DRAW(blitterDraw32x32Masked, 32, 32, 1)
+
+// -- Fetch the pixel data of a bitmap once so it can be blitted without going through the graphics API.
+void blitterGetBitmap(LCDBitmap* bitmap, BlitterBitmap* out)
+{
+    uint8_t* data = NULL;
+    uint8_t* mask = NULL;
+
+    pd->graphics->getBitmapData(bitmap, &out->width, &out->height, &out->rowbytes, &mask, &data);
+
+    out->data = data;
+    out->mask = mask;
+}
+
+// -- Copy a bitmap at (x, y) directly into a frame buffer (LCD_ROWSIZE bytes per row), honouring its mask and
+// -- only touching pixels inside [left, right[ x [top, bottom[. This matches drawBitmap() in kDrawModeCopy
+// -- with no draw offset, clip rect or stencil set.
+void blitterDraw(uint8_t* frame, const BlitterBitmap* bitmap, int x, int y, int left, int top, int right, int bottom)
+{
+    if (left < 0) {
+        left = 0;
+    }
+
+    if (top < 0) {
+        top = 0;
+    }
+
+    if (right > LCD_COLUMNS) {
+        right = LCD_COLUMNS;
+    }
+
+    if (bottom > LCD_ROWS) {
+        bottom = LCD_ROWS;
+    }
+
+    int first_row = (top > y) ? (top - y) : 0;
+    int last_row = ((bottom - y) < bitmap->height) ? (bottom - y) : bitmap->height;
+
+    int rowbytes = bitmap->rowbytes;
+
+    for (int source_y = first_row; source_y < last_row; ++source_y) {
+        uint8_t* row = frame + ((y + source_y) * LCD_ROWSIZE);
+        const uint8_t* data = bitmap->data + (source_y * rowbytes);
+        const uint8_t* mask = (bitmap->mask != NULL) ? bitmap->mask + (source_y * rowbytes) : NULL;
+
+        for (int source_x = 0; source_x < bitmap->width; source_x += 32) {
+            int draw_x = x + source_x;
+
+            uint32_t keep = blitterSpanMask(0, bitmap->width - source_x) & blitterSpanMask(left - draw_x, right - draw_x);
+            if (keep == 0) {
+                continue;
+            }
+
+            int offset = source_x / 8;
+            int nb_of_bytes = rowbytes - offset;
+
+            if (mask != NULL) {
+                keep &= blitterLoad(mask + offset, nb_of_bytes);
+            }
+
+            blitterMerge(row, draw_x, blitterLoad(data + offset, nb_of_bytes), keep);
+        }
+    }
+}
+
+// -- Read the 32 pixels starting at pixel start of a row of nb_of_bytes bytes, pixels outside of the row being 0.
+static inline uint32_t blitterLoadPixels(const uint8_t* bytes, int nb_of_bytes, int start)
+{
+    if (start < 0) {
+        return (start > -32) ? (blitterLoad(bytes, nb_of_bytes) >> -start) : 0;
+    }
+
+    int offset = start / 8;
+    int shift = start % 8;
+
+    uint32_t value = blitterLoad(bytes + offset, nb_of_bytes - offset);
+    if ((shift != 0) && ((offset + 4) < nb_of_bytes)) {
+        return (value << shift) | (bytes[offset + 4] >> (8 - shift));
+    }
+
+    return value << shift;
+}
+
+// -- Reverse the order of the pixels in a word.
+static inline uint32_t blitterReverse(uint32_t value)
+{
+    value = ((value >> 1) & 0x55555555u) | ((value & 0x55555555u) << 1);
+    value = ((value >> 2) & 0x33333333u) | ((value & 0x33333333u) << 2);
+    value = ((value >> 4) & 0x0F0F0F0Fu) | ((value & 0x0F0F0F0Fu) << 4);
+    value = ((value >> 8) & 0x00FF00FFu) | ((value & 0x00FF00FFu) << 8);
+
+    return (value >> 16) | (value << 16);
+}
+
+// -- Like blitterDraw() but with the bitmap flipped like drawBitmap() would with flip.
+void blitterDrawFlipped(uint8_t* frame, const BlitterBitmap* bitmap, int x, int y, LCDBitmapFlip flip, int left, int top, int right, int bottom)
+{
+    if (left < 0) {
+        left = 0;
+    }
+
+    if (top < 0) {
+        top = 0;
+    }
+
+    if (right > LCD_COLUMNS) {
+        right = LCD_COLUMNS;
+    }
+
+    if (bottom > LCD_ROWS) {
+        bottom = LCD_ROWS;
+    }
+
+    int flip_x = (flip == kBitmapFlippedX) || (flip == kBitmapFlippedXY);
+    int flip_y = (flip == kBitmapFlippedY) || (flip == kBitmapFlippedXY);
+
+    int first_row = (top > y) ? (top - y) : 0;
+    int last_row = ((bottom - y) < bitmap->height) ? (bottom - y) : bitmap->height;
+
+    int rowbytes = bitmap->rowbytes;
+    int width = bitmap->width;
+
+    for (int draw_row = first_row; draw_row < last_row; ++draw_row) {
+        int source_y = flip_y ? (bitmap->height - 1 - draw_row) : draw_row;
+
+        uint8_t* row = frame + ((y + draw_row) * LCD_ROWSIZE);
+        const uint8_t* data = bitmap->data + (source_y * rowbytes);
+        const uint8_t* mask = (bitmap->mask != NULL) ? bitmap->mask + (source_y * rowbytes) : NULL;
+
+        for (int draw_x = 0; draw_x < width; draw_x += 32) {
+            uint32_t keep = blitterSpanMask(0, width - draw_x) & blitterSpanMask(left - (x + draw_x), right - (x + draw_x));
+            if (keep == 0) {
+                continue;
+            }
+
+            // -- Flipped, the 32 pixels drawn at draw_x come reversed from the ones ending at width - draw_x.
+            int start = flip_x ? (width - draw_x - 32) : draw_x;
+
+            uint32_t source = blitterLoadPixels(data, rowbytes, start);
+            if (mask != NULL) {
+                keep &= flip_x ? blitterReverse(blitterLoadPixels(mask, rowbytes, start)) : blitterLoadPixels(mask, rowbytes, start);
+            }
+
+            blitterMerge(row, x + draw_x, flip_x ? blitterReverse(source) : source, keep);
+        }
+    }
+}
+
+// -- Fill the rectangle at (x, y) of size width x height in a frame buffer with white if white is set, black
+// -- otherwise, only touching pixels inside [left, right[ x [top, bottom[.
+void blitterFill(uint8_t* frame, int x, int y, int width, int height, int white, int left, int top, int right, int bottom)
+{
+    if (left < x) {
+        left = x;
+    }
+
+    if (top < y) {
+        top = y;
+    }
+
+    if (right > (x + width)) {
+        right = x + width;
+    }
+
+    if (bottom > (y + height)) {
+        bottom = y + height;
+    }
+
+    if (left < 0) {
+        left = 0;
+    }
+
+    if (top < 0) {
+        top = 0;
+    }
+
+    if (right > LCD_COLUMNS) {
+        right = LCD_COLUMNS;
+    }
+
+    if (bottom > LCD_ROWS) {
+        bottom = LCD_ROWS;
+    }
+
+    uint32_t source = white ? 0xFFFFFFFFu : 0;
+
+    for (int row_index = top; row_index < bottom; ++row_index) {
+        uint8_t* row = frame + (row_index * LCD_ROWSIZE);
+
+        for (int word_x = left & ~31; word_x < right; word_x += 32) {
+            blitterMerge(row, word_x, source, blitterSpanMask(left - word_x, right - word_x));
+        }
+    }
+}
+
+// -- Return the fastest blitter for bitmaps of a given size, falling back to blitterDraw() for unusual sizes.
+// -- masked should be set if any of the bitmaps drawn with it have a mask.
+BlitterDrawFunction blitterGetDrawFunction(int width, int height, int masked)
+{
+    if (width != height) {
+        return blitterDraw;
+    }
+
+    switch (width) {
+        case 8:
+            return masked ? blitterDraw8x8Masked : blitterDraw8x8;
+        case 16:
+            return masked ? blitterDraw16x16Masked : blitterDraw16x16;
+        case 32:
+            return masked ? blitterDraw32x32Masked : blitterDraw32x32;
+        default:
+            return blitterDraw;
+    }
+}
+
+// -- Convert a word with the leftmost pixel in the most significant bit to the order its bytes have in a frame buffer
+// -- so it can be read and written there as a native word.
+static inline uint32_t blitterToFrameOrder(uint32_t value)
+{
+    uint8_t bytes[4];
+    blitterStore(bytes, value);
+
+    uint32_t result;
+    memcpy(&result, bytes, sizeof(uint32_t));
+
+    return result;
+}
+
+// -- Pack nb_of_bitmaps bitmaps, all of the same size and at most 32 pixels wide, into an atlas. Returns NULL on error.
+BlitterAtlas* blitterAtlasNew(const BlitterBitmap* bitmaps, int nb_of_bitmaps, int preshift_budget)
+{
+    if ((nb_of_bitmaps <= 0) || (bitmaps[0].width > 32)) {
+        DM_LOG("Blitter: Atlases only support bitmaps up to 32 pixels wide.");
+        return NULL;
+    }
+
+    BlitterAtlas* this = dmMemoryCalloc(1, sizeof(BlitterAtlas));
+    if (this == NULL) {
+        return NULL;
+    }
+
+    this->nb_of_bitmaps = nb_of_bitmaps;
+    this->width = bitmaps[0].width;
+    this->height = bitmaps[0].height;
+    this->preshift_budget = preshift_budget;
+
+    this->rows = dmMemoryCalloc(nb_of_bitmaps * this->height * 2, sizeof(uint32_t));
+    this->shifted = dmMemoryCalloc(nb_of_bitmaps * 32, sizeof(uint32_t*));
+    if ((this->rows == NULL) || (this->shifted == NULL)) {
+        DM_LOG("Blitter: Error allocating an atlas for %d bitmaps.", nb_of_bitmaps);
+        blitterAtlasDelete(this);
+        return NULL;
+    }
+
+    this->memory = (nb_of_bitmaps * this->height * 2 * (int)sizeof(uint32_t)) + (nb_of_bitmaps * 32 * (int)sizeof(uint32_t*));
+
+    uint32_t width_mask = blitterSpanMask(0, this->width);
+    int nb_of_bytes = (this->width + 7) / 8;
+
+    for (int index = 0; index < nb_of_bitmaps; ++index) {
+        const BlitterBitmap* bitmap = &bitmaps[index];
+        uint32_t* rows = this->rows + (index * this->height * 2);
+
+        for (int row = 0; row < this->height; ++row) {
+            uint32_t mask = width_mask;
+            if (bitmap->mask != NULL) {
+                mask &= blitterLoad(bitmap->mask + (row * bitmap->rowbytes), nb_of_bytes);
+            }
+
+            rows[(row * 2)] = blitterLoad(bitmap->data + (row * bitmap->rowbytes), nb_of_bytes) & mask;
+            rows[(row * 2) + 1] = mask;
+        }
+    }
+
+    return this;
+}
+
+void blitterAtlasDelete(BlitterAtlas* this)
+{
+    if (this->shifted != NULL) {
+        for (int i = 0; i < (this->nb_of_bitmaps * 32); ++i) {
+            dmMemoryFree(this->shifted[i]);
+        }
+
+        dmMemoryFree(this->shifted);
+    }
+
+    dmMemoryFree(this->rows);
+    dmMemoryFree(this);
+}
+
+// -- Return the copy of bitmap index shifted right by shift pixels, as two words of data followed by two words of
+// -- mask per row in frame buffer order, making it if needed. Returns NULL if it doesn't fit in the budget.
+static const uint32_t* blitterAtlasGetShifted(BlitterAtlas* this, int index, int shift)
+{
+    uint32_t** shifted = &this->shifted[(shift * this->nb_of_bitmaps) + index];
+    if (*shifted != NULL) {
+        return *shifted;
+    }
+
+    int size = this->height * 4 * (int)sizeof(uint32_t);
+    if ((this->preshift_memory + size) > this->preshift_budget) {
+        return NULL;
+    }
+
+    uint32_t* copy = dmMemoryCalloc(this->height * 4, sizeof(uint32_t));
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    const uint32_t* rows = this->rows + (index * this->height * 2);
+    for (int row = 0; row < this->height; ++row) {
+        uint32_t data = rows[row * 2];
+        uint32_t mask = rows[(row * 2) + 1];
+
+        copy[(row * 4)] = blitterToFrameOrder(data >> shift);
+        copy[(row * 4) + 1] = blitterToFrameOrder((shift != 0) ? (data << (32 - shift)) : 0);
+        copy[(row * 4) + 2] = blitterToFrameOrder(mask >> shift);
+        copy[(row * 4) + 3] = blitterToFrameOrder((shift != 0) ? (mask << (32 - shift)) : 0);
+    }
+
+    *shifted = copy;
+    this->preshift_memory += size;
+    this->memory += size;
+
+    return copy;
+}
+
+// -- Draw bitmap index of the atlas like blitterDraw() would.
+void blitterAtlasDraw(BlitterAtlas* this, uint8_t* frame, int index, int x, int y, int left, int top, int right, int bottom)
+{
+    if (left < 0) {
+        left = 0;
+    }
+
+    if (top < 0) {
+        top = 0;
+    }
+
+    if (right > LCD_COLUMNS) {
+        right = LCD_COLUMNS;
+    }
+
+    if (bottom > LCD_ROWS) {
+        bottom = LCD_ROWS;
+    }
+
+    int first_row = (top > y) ? (top - y) : 0;
+    int last_row = ((bottom - y) < this->height) ? (bottom - y) : this->height;
+    if (first_row >= last_row) {
+        return;
+    }
+
+    int shift = x & 31;
+    int word_index = (x - shift) / 32;
+
+    const uint32_t* shifted = blitterAtlasGetShifted(this, index, shift);
+    if (shifted == NULL) {
+        // -- Over budget, shift the packed rows while drawing instead.
+        uint32_t keep = blitterSpanMask(left - x, right - x);
+        const uint32_t* rows = this->rows + (index * this->height * 2);
+
+        for (int row = first_row; row < last_row; ++row) {
+            blitterMerge(frame + ((y + row) * LCD_ROWSIZE), x, rows[row * 2], rows[(row * 2) + 1] & keep);
+        }
+
+        return;
+    }
+
+    // -- Clip against the two frame buffer words the bitmap's rows can touch.
+    uint32_t clip[2];
+    for (int i = 0; i < 2; ++i) {
+        int word_x = (word_index + i) * 32;
+        int inside = ((word_index + i) >= 0) && ((word_index + i) < BLITTER_FRAME_WORDS);
+        clip[i] = inside ? blitterToFrameOrder(blitterSpanMask(left - word_x, right - word_x)) : 0;
+    }
+
+    if ((shift + this->width) <= 32) {
+        clip[1] = 0;
+    }
+
+    uint8_t* row_bytes = frame + ((y + first_row) * LCD_ROWSIZE) + (word_index * 4);
+    shifted += first_row * 4;
+
+    for (int row = first_row; row < last_row; ++row) {
+        for (int i = 0; i < 2; ++i) {
+            uint32_t keep = shifted[2 + i] & clip[i];
+            if (keep == 0) {
+                continue;
+            }
+
+            uint32_t value;
+            memcpy(&value, row_bytes + (i * 4), sizeof(uint32_t));
+            value = (value & ~keep) | (shifted[i] & keep);
+            memcpy(row_bytes + (i * 4), &value, sizeof(uint32_t));
+        }
+
+        row_bytes += LCD_ROWSIZE;
+        shifted += 4;
+    }
+}
@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef DM_BLITTER_H
+#define DM_BLITTER_H
+
+#include "pd_api.h"
+
+// -- Raw 1-bit pixel data of a bitmap, most significant bit first. mask is NULL for opaque bitmaps.
+typedef struct {
+    const uint8_t* data;
+    const uint8_t* mask;
+    int rowbytes;
+
+    int width;
+    int height;
+} BlitterBitmap;
+
+// -- Bitmaps up to 32 pixels wide packed as one 32 bit word of data and one of mask per row, with the data already
+// -- masked. Copies of each bitmap shifted to every position within a frame buffer word are made the first time they
+// -- are needed, as long as they fit in preshift_budget bytes, so that drawing them is only aligned word writes.
+typedef struct {
+    int nb_of_bitmaps;
+    int width;
+    int height;
+
+    uint32_t* rows;
+
+    // -- shifted[(shift * nb_of_bitmaps) + index] is NULL until the copy is made.
+    uint32_t** shifted;
+    int preshift_budget;
+    int preshift_memory;
+
+    int memory;
+} BlitterAtlas;
+
+typedef void (*BlitterDrawFunction)(uint8_t* frame, const BlitterBitmap* bitmap, int x, int y, int left, int top, int right, int bottom);
+
+extern void blitterGetBitmap(LCDBitmap* bitmap, BlitterBitmap* out);
+extern void blitterDraw(uint8_t* frame, const BlitterBitmap* bitmap, int x, int y, int left, int top, int right, int bottom);
+extern void blitterDrawFlipped(uint8_t* frame, const BlitterBitmap* bitmap, int x, int y, LCDBitmapFlip flip, int left, int top, int right, int bottom);
+extern void blitterFill(uint8_t* frame, int x, int y, int width, int height, int white, int left, int top, int right, int bottom);
+extern BlitterDrawFunction blitterGetDrawFunction(int width, int height, int masked);
+
+extern BlitterAtlas* blitterAtlasNew(const BlitterBitmap* bitmaps, int nb_of_bitmaps, int preshift_budget);
+extern void blitterAtlasDelete(BlitterAtlas* this);
+extern void blitterAtlasDraw(BlitterAtlas* this, uint8_t* frame, int index, int x, int y, int left, int top, int right, int bottom);
+
+#endif
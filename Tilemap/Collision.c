@@ -0,0 +1,428 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#include "Tilemap/Collision.h"
+
+#define DM_LOG_ENABLE
+#include "pdbase/pdbase.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// -- Return 1 if a cell set to value is solid, whichever way it is flipped.
+static inline int collisionIsSolidValue(const Collision* this, uint16_t value)
+{
+    value &= TILE_STORAGE_INDEX_MASK;
+
+    return (value <= this->nb_of_tiles) && this->solid_tiles[value];
+}
+
+// -- Free every chunk and the chunk table itself.
+static void collisionFreeChunks(Collision* this)
+{
+    if (this->chunks == NULL) {
+        return;
+    }
+
+    int nb_of_chunks = this->chunks_wide * this->chunks_high;
+    for (int i = 0; i < nb_of_chunks; ++i) {
+        if (this->chunks[i] != NULL) {
+            if (this->chunks[i]->rects != NULL) {
+                arenaFree(this->arena, this->chunks[i]->rects);
+            }
+
+            arenaFree(this->arena, this->chunks[i]);
+        }
+    }
+
+    arenaFree(this->arena, this->chunks);
+    this->chunks = NULL;
+}
+
+// -- Allocate collision tracking for a tileset of nb_of_tiles images, in arena or on the heap if arena is NULL.
+// -- Every tile starts off solid.
+Collision* collisionNew(int nb_of_tiles, Arena* arena)
+{
+    Collision* this = arenaCalloc(arena, 1, sizeof(Collision));
+    if (this == NULL) {
+        return NULL;
+    }
+
+    this->arena = arena;
+
+    this->solid_tiles = arenaCalloc(this->arena, nb_of_tiles + 1, sizeof(uint8_t));
+    if (this->solid_tiles == NULL) {
+        DM_LOG("Collision: Error allocating solid tiles for %d tiles.", nb_of_tiles);
+        arenaFree(arena, this);
+        return NULL;
+    }
+
+    this->nb_of_tiles = nb_of_tiles;
+    for (int index = 1; index <= nb_of_tiles; ++index) {
+        this->solid_tiles[index] = 1;
+    }
+
+    return this;
+}
+
+void collisionDelete(Collision* this)
+{
+    collisionFreeChunks(this);
+
+    arenaFree(this->arena, this->solid_tiles);
+    Arena* arena = this->arena;
+    arenaFree(arena, this);
+}
+
+// -- Set which tile indices are solid. Returns 1 if that changed, in which case collisionSetMap() must be called
+// -- again before the next query.
+int collisionSetTileSolid(Collision* this, int index, int solid)
+{
+    if ((index < 1) || (index > this->nb_of_tiles) || (this->solid_tiles[index] == (solid != 0))) {
+        return 0;
+    }
+
+    this->solid_tiles[index] = (solid != 0);
+
+    return 1;
+}
+
+// -- Find all the solid cells in map, which is then tracked until the next call, or stop tracking any map if map is
+// -- NULL. Returns 0 on error.
+int collisionSetMap(Collision* this, const TileStorage* map)
+{
+    collisionFreeChunks(this);
+
+    this->map = map;
+    if (map == NULL) {
+        return 1;
+    }
+
+    this->chunks_wide = map->chunks_wide;
+    this->chunks_high = map->chunks_high;
+
+    this->chunks = arenaCalloc(this->arena, this->chunks_wide * this->chunks_high, sizeof(CollisionChunk*));
+    if (this->chunks == NULL) {
+        DM_LOG("Collision: Error allocating chunk table for %dx%d chunks.", this->chunks_wide, this->chunks_high);
+        this->map = NULL;
+        return 0;
+    }
+
+    for (int chunk_index = 0; chunk_index < (this->chunks_wide * this->chunks_high); ++chunk_index) {
+        const TileChunk* tile_chunk = map->chunks[chunk_index];
+        if (tile_chunk == NULL) {
+            continue;
+        }
+
+        CollisionChunk* chunk = NULL;
+
+        for (int row = 0; row < TILE_STORAGE_CHUNK_SIZE; ++row) {
+            int first_cell = row << TILE_STORAGE_CHUNK_SHIFT;
+            uint32_t occupied = tile_chunk->row_occupancy[row];
+            uint32_t solid = 0;
+
+            while (occupied != 0) {
+                int column = __builtin_ctz(occupied);
+                occupied &= occupied - 1;
+
+                if (collisionIsSolidValue(this, tileStorageGetChunkCell(map, tile_chunk, first_cell + column))) {
+                    solid |= 1u << column;
+                }
+            }
+
+            if (solid == 0) {
+                continue;
+            }
+
+            if (chunk == NULL) {
+                chunk = arenaCalloc(this->arena, 1, sizeof(CollisionChunk));
+                if (chunk == NULL) {
+                    DM_LOG("Collision: Error allocating chunk.");
+                    collisionFreeChunks(this);
+                    this->map = NULL;
+                    return 0;
+                }
+
+                chunk->rects_need_update = 1;
+                this->chunks[chunk_index] = chunk;
+            }
+
+            chunk->solid_rows[row] = solid;
+            chunk->nb_of_solid_cells += __builtin_popcount(solid);
+        }
+    }
+
+    return 1;
+}
+
+// -- Update cell (x, y), 0-based, after its value changed in the map.
+void collisionUpdateCell(Collision* this, int x, int y)
+{
+    if (this->map == NULL) {
+        return;
+    }
+
+    int chunk_index = ((y >> TILE_STORAGE_CHUNK_SHIFT) * this->chunks_wide) + (x >> TILE_STORAGE_CHUNK_SHIFT);
+    CollisionChunk* chunk = this->chunks[chunk_index];
+
+    int solid = collisionIsSolidValue(this, tileStorageGet(this->map, x, y));
+    if ((chunk == NULL) && !solid) {
+        return;
+    }
+
+    if (chunk == NULL) {
+        chunk = arenaCalloc(this->arena, 1, sizeof(CollisionChunk));
+        if (chunk == NULL) {
+            DM_LOG("Collision: Error allocating chunk for cell %d,%d.", x, y);
+            return;
+        }
+
+        this->chunks[chunk_index] = chunk;
+    }
+
+    uint32_t* row = &chunk->solid_rows[y & TILE_STORAGE_CHUNK_MASK];
+    uint32_t bit = 1u << (x & TILE_STORAGE_CHUNK_MASK);
+
+    if (solid == ((*row & bit) != 0)) {
+        return;
+    }
+
+    if (solid) {
+        *row |= bit;
+        ++chunk->nb_of_solid_cells;
+    }
+    else {
+        *row &= ~bit;
+        --chunk->nb_of_solid_cells;
+    }
+
+    chunk->rects_need_update = 1;
+
+    if (chunk->nb_of_solid_cells == 0) {
+        if (chunk->rects != NULL) {
+            arenaFree(this->arena, chunk->rects);
+        }
+
+        arenaFree(this->arena, chunk);
+        this->chunks[chunk_index] = NULL;
+    }
+}
+
+// -- Return 1 if any cell in [first_x, last_x] x [first_y, last_y], 0-based, is solid. Cells outside of the map
+// -- are never solid.
+int collisionHasSolidCells(const Collision* this, int first_x, int first_y, int last_x, int last_y)
+{
+    if (this->map == NULL) {
+        return 0;
+    }
+
+    first_x = (first_x < 0) ? 0 : first_x;
+    first_y = (first_y < 0) ? 0 : first_y;
+    last_x = (last_x >= this->map->width) ? this->map->width - 1 : last_x;
+    last_y = (last_y >= this->map->height) ? this->map->height - 1 : last_y;
+
+    for (int chunk_y = first_y >> TILE_STORAGE_CHUNK_SHIFT; chunk_y <= (last_y >> TILE_STORAGE_CHUNK_SHIFT); ++chunk_y) {
+        int chunk_cell_y = chunk_y << TILE_STORAGE_CHUNK_SHIFT;
+        int first_row = (first_y > chunk_cell_y) ? (first_y - chunk_cell_y) : 0;
+        int last_row = ((last_y - chunk_cell_y) < TILE_STORAGE_CHUNK_MASK) ? (last_y - chunk_cell_y) : TILE_STORAGE_CHUNK_MASK;
+
+        for (int chunk_x = first_x >> TILE_STORAGE_CHUNK_SHIFT; chunk_x <= (last_x >> TILE_STORAGE_CHUNK_SHIFT); ++chunk_x) {
+            const CollisionChunk* chunk = this->chunks[(chunk_y * this->chunks_wide) + chunk_x];
+            if (chunk == NULL) {
+                continue;
+            }
+
+            int chunk_cell_x = chunk_x << TILE_STORAGE_CHUNK_SHIFT;
+            int first_column = (first_x > chunk_cell_x) ? (first_x - chunk_cell_x) : 0;
+            int last_column = ((last_x - chunk_cell_x) < TILE_STORAGE_CHUNK_MASK) ? (last_x - chunk_cell_x) : TILE_STORAGE_CHUNK_MASK;
+            uint32_t column_mask = (0xFFFFFFFFu << first_column) & (0xFFFFFFFFu >> (TILE_STORAGE_CHUNK_MASK - last_column));
+
+            for (int row = first_row; row <= last_row; ++row) {
+                if ((chunk->solid_rows[row] & column_mask) != 0) {
+                    return 1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+// -- Cover the solid cells of a chunk with rectangles, greedily growing each run of solid cells downwards.
+// -- Only counts the rectangles if rects is NULL.
+static int collisionMergeRects(const CollisionChunk* chunk, CollisionRect* rects)
+{
+    uint32_t rows[TILE_STORAGE_CHUNK_SIZE];
+    for (int row = 0; row < TILE_STORAGE_CHUNK_SIZE; ++row) {
+        rows[row] = chunk->solid_rows[row];
+    }
+
+    int nb_of_rects = 0;
+
+    for (int row = 0; row < TILE_STORAGE_CHUNK_SIZE; ++row) {
+        while (rows[row] != 0) {
+            int start = __builtin_ctz(rows[row]);
+            uint32_t remaining = ~(rows[row] >> start);
+            int length = (remaining == 0) ? (TILE_STORAGE_CHUNK_SIZE - start) : __builtin_ctz(remaining);
+            uint32_t run = ((length == TILE_STORAGE_CHUNK_SIZE) ? 0xFFFFFFFFu : ((1u << length) - 1)) << start;
+
+            int height = 1;
+            while (((row + height) < TILE_STORAGE_CHUNK_SIZE) && ((rows[row + height] & run) == run)) {
+                rows[row + height] &= ~run;
+                ++height;
+            }
+
+            rows[row] &= ~run;
+
+            if (rects != NULL) {
+                rects[nb_of_rects].x = (uint8_t)start;
+                rects[nb_of_rects].y = (uint8_t)row;
+                rects[nb_of_rects].width = (uint8_t)length;
+                rects[nb_of_rects].height = (uint8_t)height;
+            }
+
+            ++nb_of_rects;
+        }
+    }
+
+    return nb_of_rects;
+}
+
+// -- Returns the chunk at chunk coordinates (chunk_x, chunk_y) with its rectangles up to date, or NULL if it
+// -- doesn't have any solid cells.
+const CollisionChunk* collisionGetChunk(Collision* this, int chunk_x, int chunk_y)
+{
+    CollisionChunk* chunk = this->chunks[(chunk_y * this->chunks_wide) + chunk_x];
+    if ((chunk == NULL) || !chunk->rects_need_update) {
+        return chunk;
+    }
+
+    if (chunk->rects != NULL) {
+        arenaFree(this->arena, chunk->rects);
+        chunk->rects = NULL;
+    }
+
+    chunk->nb_of_rects = collisionMergeRects(chunk, NULL);
+    chunk->rects = arenaCalloc(this->arena, chunk->nb_of_rects, sizeof(CollisionRect));
+    if (chunk->rects == NULL) {
+        DM_LOG("Collision: Error allocating %d rects.", chunk->nb_of_rects);
+        chunk->nb_of_rects = 0;
+        return chunk;
+    }
+
+    collisionMergeRects(chunk, chunk->rects);
+    chunk->rects_need_update = 0;
+
+    return chunk;
+}
+
+// -- Walk the cells crossed by the segment from (x0, y0) to (x1, y1), in pixels, until one of them is solid. Returns
+// -- 1 and fills in hit if one was found, 0 otherwise. Cells are visited in order, as in Amanatides & Woo's "A Fast
+// -- Voxel Traversal Algorithm for Ray Tracing", so the cost only depends on the number of cells of the map crossed.
+int collisionRaycast(const Collision* this, float x0, float y0, float x1, float y1, int tile_width, int tile_height, CollisionHit* hit)
+{
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+
+    // -- Checking dx and dy as well catches segments too long to be represented.
+    if ((this->map == NULL) || !isfinite(x0) || !isfinite(y0) || !isfinite(dx) || !isfinite(dy)) {
+        return 0;
+    }
+
+    // -- Clip the segment to the map's pixels first, as in Liang & Barsky's "A New Concept and Method for Line
+    // -- Clipping", so that segments far outside of it don't walk cells that can't be solid. t_start and t_end are the
+    // -- fractions of the segment where it enters and leaves the map.
+    float p[4] = { -dx, dx, -dy, dy };
+    float q[4] = { x0, ((float)this->map->width * tile_width) - x0, y0, ((float)this->map->height * tile_height) - y0 };
+    static const int edge_normals[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+    float t_start = 0.0f;
+    float t_end = 1.0f;
+    int normal_x = 0;
+    int normal_y = 0;
+
+    for (int edge = 0; edge < 4; ++edge) {
+        if (p[edge] == 0.0f) {
+            if (q[edge] < 0.0f) {
+                return 0;
+            }
+
+            continue;
+        }
+
+        float t_edge = q[edge] / p[edge];
+        if (p[edge] < 0.0f) {
+            if (t_edge > t_start) {
+                t_start = t_edge;
+                normal_x = edge_normals[edge][0];
+                normal_y = edge_normals[edge][1];
+            }
+        }
+        else if (t_edge < t_end) {
+            t_end = t_edge;
+        }
+    }
+
+    if (t_start > t_end) {
+        return 0;
+    }
+
+    // -- Walk the clipped segment itself so that positions keep their precision when the original one was huge.
+    x1 = x0 + (dx * t_end);
+    y1 = y0 + (dy * t_end);
+    x0 += dx * t_start;
+    y0 += dy * t_start;
+    dx = x1 - x0;
+    dy = y1 - y0;
+
+    int cell_x = (int)floorf(x0 / tile_width);
+    int cell_y = (int)floorf(y0 / tile_height);
+    int last_cell_x = (int)floorf(x1 / tile_width);
+    int last_cell_y = (int)floorf(y1 / tile_height);
+
+    int step_x = (dx > 0.0f) ? 1 : ((dx < 0.0f) ? -1 : 0);
+    int step_y = (dy > 0.0f) ? 1 : ((dy < 0.0f) ? -1 : 0);
+
+    // -- Distances are expressed as a fraction of the segment's length, crossing a whole cell takes t_delta.
+    float t_delta_x = (step_x != 0) ? (tile_width / fabsf(dx)) : INFINITY;
+    float t_delta_y = (step_y != 0) ? (tile_height / fabsf(dy)) : INFINITY;
+    float t_max_x = (step_x != 0) ? ((((step_x > 0) ? (cell_x + 1) : cell_x) * tile_width) - x0) / dx : INFINITY;
+    float t_max_y = (step_y != 0) ? ((((step_y > 0) ? (cell_y + 1) : cell_y) * tile_height) - y0) / dy : INFINITY;
+
+    float t = 0.0f;
+
+    int nb_of_steps = abs(last_cell_x - cell_x) + abs(last_cell_y - cell_y);
+
+    for (int i = 0; ; ++i) {
+        if (collisionIsSolid(this, cell_x, cell_y)) {
+            hit->cell_x = cell_x;
+            hit->cell_y = cell_y;
+            hit->x = x0 + (dx * t);
+            hit->y = y0 + (dy * t);
+            hit->normal_x = normal_x;
+            hit->normal_y = normal_y;
+
+            return 1;
+        }
+
+        if (i == nb_of_steps) {
+            return 0;
+        }
+
+        if (t_max_x < t_max_y) {
+            t = t_max_x;
+            t_max_x += t_delta_x;
+            cell_x += step_x;
+            normal_x = -step_x;
+            normal_y = 0;
+        }
+        else {
+            t = t_max_y;
+            t_max_y += t_delta_y;
+            cell_y += step_y;
+            normal_x = 0;
+            normal_y = -step_y;
+        }
+    }
+}
@@ -0,0 +1,80 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef DM_COLLISION_H
+#define DM_COLLISION_H
+
+#include "pd_api.h"
+
+#include "Tilemap/TileStorage.h"
+
+// -- A rectangle of solid cells, relative to the top left corner of its chunk.
+typedef struct {
+    uint8_t x;
+    uint8_t y;
+    uint8_t width;
+    uint8_t height;
+} CollisionRect;
+
+// -- Solid cells for one chunk of the map's storage. Bit x of solid_rows[y] is set if cell (x, y) is solid.
+// -- rects covers the same cells with as few rectangles as the greedy merge can find and is only rebuilt when
+// -- needed.
+typedef struct {
+    uint32_t solid_rows[TILE_STORAGE_CHUNK_SIZE];
+    int nb_of_solid_cells;
+
+    int rects_need_update;
+    int nb_of_rects;
+    CollisionRect* rects;
+} CollisionChunk;
+
+// -- Tracks which cells of a map are solid, according to which tile indices are. Chunks without any solid cell
+// -- are not allocated.
+typedef struct {
+    Arena* arena;
+    const TileStorage* map;
+
+    int chunks_wide;
+    int chunks_high;
+    CollisionChunk** chunks;
+
+    // -- solid_tiles[index] is 1 if cells set to index are solid, index 0 is never solid.
+    int nb_of_tiles;
+    uint8_t* solid_tiles;
+} Collision;
+
+// -- Where a ray first hit a solid cell. normal_x and normal_y are 0 if the ray started inside the cell.
+typedef struct {
+    int cell_x;
+    int cell_y;
+
+    float x;
+    float y;
+
+    int normal_x;
+    int normal_y;
+} CollisionHit;
+
+extern Collision* collisionNew(int nb_of_tiles, Arena* arena);
+extern void collisionDelete(Collision* this);
+extern int collisionSetMap(Collision* this, const TileStorage* map);
+extern int collisionSetTileSolid(Collision* this, int index, int solid);
+extern void collisionUpdateCell(Collision* this, int x, int y);
+extern int collisionHasSolidCells(const Collision* this, int first_x, int first_y, int last_x, int last_y);
+extern const CollisionChunk* collisionGetChunk(Collision* this, int chunk_x, int chunk_y);
+extern int collisionRaycast(const Collision* this, float x0, float y0, float x1, float y1, int tile_width, int tile_height, CollisionHit* hit);
+
+// -- Returns 1 if cell (x, y), 0-based, is solid. Cells outside of the map are never solid.
+static inline int collisionIsSolid(const Collision* this, int x, int y)
+{
+    if ((this->map == NULL) || (x < 0) || (y < 0) || (x >= this->map->width) || (y >= this->map->height)) {
+        return 0;
+    }
+
+    const CollisionChunk* chunk = this->chunks[((y >> TILE_STORAGE_CHUNK_SHIFT) * this->chunks_wide) + (x >> TILE_STORAGE_CHUNK_SHIFT)];
+
+    return (chunk != NULL) && ((chunk->solid_rows[y & TILE_STORAGE_CHUNK_MASK] >> (x & TILE_STORAGE_CHUNK_MASK)) & 1);
+}
+
+#endif
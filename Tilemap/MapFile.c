@@ -0,0 +1,189 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#include "Tilemap/MapFile.h"
+
+#define DM_LOG_ENABLE
+#include "pdbase/pdbase.h"
+
+#include <string.h>
+
+// -- Size of the buffer cell data is streamed through.
+#define MAP_FILE_BUFFER_SIZE    4096
+
+struct MapFileReader {
+    SDFile* file;
+
+    int width;
+    int height;
+    int current_row;
+
+    uint8_t buffer[MAP_FILE_BUFFER_SIZE];
+};
+
+static inline uint32_t mapFileRead16(const uint8_t* bytes)
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8);
+}
+
+static inline uint32_t mapFileRead32(const uint8_t* bytes)
+{
+    return mapFileRead16(bytes) | (mapFileRead16(bytes + 2) << 16);
+}
+
+// -- Open a map file and read its header. Returns NULL if the file can't be read, isn't a valid map file or its map
+// -- is wider or taller than max_size tiles.
+MapFileReader* mapFileOpen(const char* path, int max_size)
+{
+    MapFileReader* this = dmMemoryCalloc(1, sizeof(MapFileReader));
+    if (this == NULL) {
+        return NULL;
+    }
+
+    this->file = pd->file->open(path, kFileRead | kFileReadData);
+    if (this->file == NULL) {
+        DM_LOG("MapFile: Error opening '%s' (%s).", path, pd->file->geterr());
+        dmMemoryFree(this);
+        return NULL;
+    }
+
+    uint8_t header[MAP_FILE_HEADER_SIZE];
+    if ((pd->file->read(this->file, header, MAP_FILE_HEADER_SIZE) != MAP_FILE_HEADER_SIZE) ||
+        (memcmp(header, MAP_FILE_MAGIC, 4) != 0)) {
+        DM_LOG("MapFile: '%s' is not a map file.", path);
+        mapFileClose(this);
+        return NULL;
+    }
+
+    uint32_t version = mapFileRead16(header + 4);
+    if (version != MAP_FILE_VERSION) {
+        DM_LOG("MapFile: '%s' has unsupported version %d.", path, (int)version);
+        mapFileClose(this);
+        return NULL;
+    }
+
+    uint32_t width = mapFileRead32(header + 8);
+    uint32_t height = mapFileRead32(header + 12);
+    if ((width == 0) || (height == 0) || (width > 0xFFFF) || (height > 0xFFFF)) {
+        DM_LOG("MapFile: '%s' has an invalid size of %dx%d.", path, (int)width, (int)height);
+        mapFileClose(this);
+        return NULL;
+    }
+
+    if ((width > (uint32_t)max_size) || (height > (uint32_t)max_size)) {
+        DM_LOG("MapFile: Map '%s' is too big (%dx%d).", path, (int)width, (int)height);
+        mapFileClose(this);
+        return NULL;
+    }
+
+    this->width = (int)width;
+    this->height = (int)height;
+    this->current_row = 0;
+
+    return this;
+}
+
+void mapFileClose(MapFileReader* this)
+{
+    if (this->file != NULL) {
+        pd->file->close(this->file);
+        this->file = NULL;
+    }
+
+    dmMemoryFree(this);
+}
+
+int mapFileGetWidth(const MapFileReader* this)
+{
+    return this->width;
+}
+
+int mapFileGetHeight(const MapFileReader* this)
+{
+    return this->height;
+}
+
+// -- Number of rows read so far.
+int mapFileGetCurrentRow(const MapFileReader* this)
+{
+    return this->current_row;
+}
+
+int mapFileIsComplete(const MapFileReader* this)
+{
+    return this->current_row >= this->height;
+}
+
+// -- Read up to nb_of_rows more rows of cells into map, which must be empty and at least as big as the file's map.
+// -- Data is read in large blocks and only non-empty cells are stored. Returns 0 on a read error.
+int mapFileReadRows(MapFileReader* this, TileStorage* map, int nb_of_rows)
+{
+    int last_row = this->current_row + nb_of_rows;
+    if (last_row > this->height) {
+        last_row = this->height;
+    }
+
+    int64_t nb_of_cells = (int64_t)(last_row - this->current_row) * this->width;
+    int x = 0;
+    int y = this->current_row;
+
+    while (nb_of_cells > 0) {
+        int nb_of_cells_in_block = MAP_FILE_BUFFER_SIZE / 2;
+        if (nb_of_cells_in_block > nb_of_cells) {
+            nb_of_cells_in_block = (int)nb_of_cells;
+        }
+
+        int nb_of_bytes = nb_of_cells_in_block * 2;
+        if (pd->file->read(this->file, this->buffer, nb_of_bytes) != nb_of_bytes) {
+            DM_LOG("MapFile: Error reading cells at row %d (%s).", y, pd->file->geterr());
+            return 0;
+        }
+
+        const uint8_t* bytes = this->buffer;
+        for (int i = 0; i < nb_of_cells_in_block; ++i) {
+            uint16_t value = (uint16_t)mapFileRead16(bytes);
+            if ((value != 0) && !tileStorageSet(map, x, y, value)) {
+                return 0;
+            }
+
+            bytes += 2;
+
+            if (++x == this->width) {
+                x = 0;
+                ++y;
+            }
+        }
+
+        nb_of_cells -= nb_of_cells_in_block;
+    }
+
+    this->current_row = last_row;
+
+    return 1;
+}
+
+// -- Load a whole map file in one go, into arena or on the heap if arena is NULL. Returns NULL on error or if the map
+// -- is wider or taller than max_size tiles, in which case nothing is allocated for it.
+TileStorage* mapFileLoad(const char* path, int max_size, Arena* arena)
+{
+    MapFileReader* reader = mapFileOpen(path, max_size);
+    if (reader == NULL) {
+        return NULL;
+    }
+
+    TileStorage* map = tileStorageNew(reader->width, reader->height, arena);
+    if (map == NULL) {
+        mapFileClose(reader);
+        return NULL;
+    }
+
+    if (!mapFileReadRows(reader, map, reader->height)) {
+        tileStorageDelete(map);
+        map = NULL;
+    }
+
+    mapFileClose(reader);
+
+    return map;
+}
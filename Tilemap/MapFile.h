@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef DM_MAPFILE_H
+#define DM_MAPFILE_H
+
+#include "pd_api.h"
+
+#include "Tilemap/TileStorage.h"
+
+// -- Binary map files start with a 16 byte header, all values little endian:
+// --     char magic[4]      "DMTM"
+// --     uint16_t version   MAP_FILE_VERSION
+// --     uint16_t flags     0, reserved
+// --     uint32_t width     in tiles
+// --     uint32_t height    in tiles
+// -- followed by width x height uint16_t cell values, row by row, using the same 1-based image indices
+// -- as setTileAtPosition() with 0 for empty cells and how the image is flipped in the top two bits.
+#define MAP_FILE_MAGIC          "DMTM"
+#define MAP_FILE_VERSION        1
+#define MAP_FILE_HEADER_SIZE    16
+
+typedef struct MapFileReader MapFileReader;
+
+extern MapFileReader* mapFileOpen(const char* path, int max_size);
+extern void mapFileClose(MapFileReader* this);
+extern int mapFileGetWidth(const MapFileReader* this);
+extern int mapFileGetHeight(const MapFileReader* this);
+extern int mapFileGetCurrentRow(const MapFileReader* this);
+extern int mapFileReadRows(MapFileReader* this, TileStorage* map, int nb_of_rows);
+extern int mapFileIsComplete(const MapFileReader* this);
+extern TileStorage* mapFileLoad(const char* path, int max_size, Arena* arena);
+
+#endif
@@ -0,0 +1,67 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#include "Tilemap/Occupancy.h"
+
+#define DM_LOG_ENABLE
+#include "pdbase/pdbase.h"
+
+// -- Allocate an empty occupancy index for a map of width x height cells.
+int occupancySetup(Occupancy* this, int width, int height)
+{
+    occupancyFree(this);
+
+    this->width = width;
+    this->height = height;
+    this->words_per_row = (width + 31) / 32;
+
+    this->bits = dmMemoryCalloc(this->words_per_row * height, sizeof(uint32_t));
+    this->row_counts = dmMemoryCalloc(height, sizeof(uint16_t));
+
+    if ((this->bits == NULL) || (this->row_counts == NULL)) {
+        DM_LOG("Occupancy: Error allocating index for %dx%d cells.", width, height);
+        occupancyFree(this);
+        return 0;
+    }
+
+    return 1;
+}
+
+void occupancyFree(Occupancy* this)
+{
+    if (this->bits != NULL) {
+        dmMemoryFree(this->bits);
+        this->bits = NULL;
+    }
+
+    if (this->row_counts != NULL) {
+        dmMemoryFree(this->row_counts);
+        this->row_counts = NULL;
+    }
+
+    this->width = 0;
+    this->height = 0;
+    this->words_per_row = 0;
+    this->nb_of_occupied_cells = 0;
+}
+
+// -- Mark cell (x, y), 0-based, as occupied or empty.
+void occupancySet(Occupancy* this, int x, int y, int occupied)
+{
+    uint32_t* word = this->bits + (y * this->words_per_row) + (x >> 5);
+    uint32_t bit = 1u << (x & 31);
+
+    if (occupied) {
+        if ((*word & bit) == 0) {
+            *word |= bit;
+            ++this->row_counts[y];
+            ++this->nb_of_occupied_cells;
+        }
+    }
+    else if ((*word & bit) != 0) {
+        *word &= ~bit;
+        --this->row_counts[y];
+        --this->nb_of_occupied_cells;
+    }
+}
@@ -0,0 +1,48 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef DM_OCCUPANCY_H
+#define DM_OCCUPANCY_H
+
+#include "pd_api.h"
+
+// -- Tracks which cells of a map are not empty, as one bit per cell plus a count per row, so draw loops
+// -- can skip empty rows entirely and jump between occupied cells within a row.
+typedef struct {
+    int width;
+    int height;
+    int words_per_row;
+
+    uint32_t* bits;
+    uint16_t* row_counts;
+    int nb_of_occupied_cells;
+} Occupancy;
+
+extern int occupancySetup(Occupancy* this, int width, int height);
+extern void occupancyFree(Occupancy* this);
+extern void occupancySet(Occupancy* this, int x, int y, int occupied);
+
+// -- Returns the first occupied column at or after x in row y, or the map's width if there are none.
+static inline int occupancyNextInRow(const Occupancy* this, int y, int x)
+{
+    if ((x >= this->width) || (this->row_counts[y] == 0)) {
+        return this->width;
+    }
+
+    const uint32_t* row = this->bits + (y * this->words_per_row);
+    int word_index = x >> 5;
+    uint32_t word = row[word_index] & (0xFFFFFFFFu << (x & 31));
+
+    while (word == 0) {
+        if (++word_index >= this->words_per_row) {
+            return this->width;
+        }
+
+        word = row[word_index];
+    }
+
+    return (word_index << 5) + __builtin_ctz(word);
+}
+
+#endif
@@ -3,6 +3,8 @@
 // SPDX-License-Identifier: MIT
 
 #include "Tilemap/OldCTilemap.h"
+#include "Tilemap/Blitter.h"
+#include "Tilemap/Occupancy.h"
 
 #define DM_LOG_ENABLE
 #include "pdbase/pdbase.h"
@@ -25,8 +27,13 @@ typedef struct {
 
     int nb_of_tiles;
     LCDBitmap** tiles;
+    BlitterBitmap* tile_data;
+
+    int direct_draw;
+    BlitterDrawFunction blit;
     
     uint16_t* map;
+    Occupancy occupancy;
 } OldCTilemap;
 
 // -- Get an argument as a OldCTilemap class
@@ -45,6 +52,68 @@ extern void register_OldCTilemap(PlaydateAPI* api)
     }
 }
 
+// -- Set the value of cell (x, y), 0-based, keeping the occupancy index up to date.
+void oldCTilemapSetCell(OldCTilemap* this, int x, int y, uint16_t value)
+{
+    this->map[(y * this->width) + x] = value;
+    occupancySet(&this->occupancy, x, y, value != 0);
+}
+
+// -- Clip a rectangle of cells, 0-based, to the map. Returns 0 if nothing is left.
+int oldCTilemapClipRect(OldCTilemap* this, int* x, int* y, int* width, int* height)
+{
+    if (*x < 0) {
+        *width += *x;
+        *x = 0;
+    }
+
+    if (*y < 0) {
+        *height += *y;
+        *y = 0;
+    }
+
+    if (*width > (this->width - *x)) {
+        *width = this->width - *x;
+    }
+
+    if (*height > (this->height - *y)) {
+        *height = this->height - *y;
+    }
+
+    return (*width > 0) && (*height > 0);
+}
+
+// -- Replace the map with an empty one of width x height tiles. Returns 0 on failure, leaving no map set.
+int oldCTilemapAllocateMap(OldCTilemap* this, int width, int height)
+{
+    if (this->map != NULL) {
+        dmMemoryFree(this->map);
+        this->map = NULL;
+    }
+    
+    this->width = width;
+    this->height = height;
+
+    if ((this->width == 0) || (this->width > 2048) || (this->height == 0) || (this->height > 2048)) {
+        DM_LOG("OldCTilemap: Trying to set an invalid size of %dx%d.", this->width, this->height);
+        return 0;
+    }
+
+    this->map = dmMemoryCalloc(this->width * this->height, sizeof(uint16_t));
+    if ((this->map == NULL) || !occupancySetup(&this->occupancy, this->width, this->height)) {
+        DM_LOG("OldCTilemap: Error allocating a map of %dx%d tiles.", this->width, this->height);
+
+        if (this->map != NULL) {
+            dmMemoryFree(this->map);
+            this->map = NULL;
+        }
+
+        return 0;
+    }
+
+    return 1;
+}
+
 // -- Allocate a new tilemap
 int oldCTilemapNew(lua_State* L)
 {
@@ -75,10 +144,14 @@ int oldCTilemapNew(lua_State* L)
     }
 
     this->tiles = dmMemoryCalloc(this->nb_of_tiles, sizeof(LCDBitmap*));
+    this->tile_data = dmMemoryCalloc(this->nb_of_tiles, sizeof(BlitterBitmap));
 
     for (int index = 0; index < this->nb_of_tiles;++index) {
         this->tiles[index] = pd->graphics->getTableBitmap(this->image_table, index);
+        blitterGetBitmap(this->tiles[index], &this->tile_data[index]);
     }
+
+    this->direct_draw = 0;
     
     this->height = 0;
     this->width = 0;
@@ -97,6 +170,16 @@ int oldCTilemapNew(lua_State* L)
     
     pd->graphics->freeBitmap(bitmap);
 
+    int masked = 0;
+    for (int index = 0; index < this->nb_of_tiles; ++index) {
+        if (this->tile_data[index].mask != NULL) {
+            masked = 1;
+            break;
+        }
+    }
+
+    this->blit = blitterGetDrawFunction(this->tile_width, this->tile_height, masked);
+
     this->map = NULL;
 
     pd->lua->pushObject(this, CLASSNAME_OLDCTILEMAP, 0);
@@ -123,11 +206,18 @@ int oldCTilemapDelete(lua_State* L)
         this->image_table = NULL;
         this->nb_of_tiles = 0;
     }
+
+    if (this->tile_data != NULL) {
+        dmMemoryFree(this->tile_data);
+        this->tile_data = NULL;
+    }
     
     if (this->map != NULL) {
         dmMemoryFree(this->map);
         this->map = NULL;
     }
+
+    occupancyFree(&this->occupancy);
     
     dmMemoryFree(this);
     
@@ -196,11 +286,26 @@ int oldCTilemapDraw(lua_State* L)
 
     //LCDBitmap* otherBitmap = pd->graphics->getTableBitmap(this->image_table, 1);
 
+    uint8_t* frame = this->direct_draw ? pd->graphics->getFrame() : NULL;
+
     int tilemap_index = (current_tile_y * width) + current_tile_x;
     while((current_draw_y < display_height) && (current_tile_y < height)) {
         int next_tilemap_index_offset = width;
 
         while((current_draw_x < display_width) && (current_tile_x < width)) {
+            // -- Jump straight over runs of empty cells.
+            int next_tile_x = occupancyNextInRow(&this->occupancy, current_tile_y, current_tile_x);
+            if (next_tile_x != current_tile_x) {
+                int nb_of_skipped_tiles = next_tile_x - current_tile_x;
+
+                next_tilemap_index_offset -= nb_of_skipped_tiles;
+                tilemap_index += nb_of_skipped_tiles;
+
+                current_draw_x += nb_of_skipped_tiles * image_width;
+                current_tile_x = next_tile_x;
+                continue;
+            }
+
             int tile_index = tilemap[tilemap_index] - 1;
             if (tile_index != 0) {
                 if (tile_index >= this->nb_of_tiles) {
@@ -208,8 +313,11 @@ int oldCTilemapDraw(lua_State* L)
                     return 0;
                 }
                 
-                LCDBitmap* bitmap = this->tiles[tile_index];
-                if (bitmap != NULL) {
+                if (frame != NULL) {
+                    this->blit(frame, &this->tile_data[tile_index], current_draw_x, current_draw_y, 0, 0, display_width, display_height);
+                }
+                else if (this->tiles[tile_index] != NULL) {
+                    LCDBitmap* bitmap = this->tiles[tile_index];
                     pd->graphics->drawBitmap(bitmap, current_draw_x, current_draw_y, kBitmapUnflipped);
                     //pd->graphics->drawBitmap(otherBitmap, current_draw_x, current_draw_y, kBitmapUnflipped);
                 }
@@ -231,6 +339,10 @@ int oldCTilemapDraw(lua_State* L)
         current_draw_y += image_height;
     }
 
+    if (frame != NULL) {
+        pd->graphics->markUpdatedRows(0, display_height - 1);
+    }
+
     return 0;
 }
 
@@ -259,12 +371,12 @@ int oldCTilemapSetTileAtPosition(lua_State* L)
     }
 
     int tilemap_index = pd->lua->getArgInt(4);
-    if (tilemap_index < 0) {
+    if ((tilemap_index < 0) || (tilemap_index > 0xFFFF)) {
         DM_LOG("OldCTilemap: Out of bounds tile index %d for getTileAtPosition.", tilemap_index);
         return 0;
     }
     
-    this->map[((y - 1) * this->width) + (x - 1)] = tilemap_index;
+    oldCTilemapSetCell(this, x - 1, y - 1, tilemap_index);
 
     return 0;
 }
@@ -297,6 +409,247 @@ int oldCTilemapGetTileAtPosition(lua_State* L)
     return 1;
 }
 
+// -- Sets the tilemap's width to width, then populates the tilemap with data, a string of little endian 16 bit
+// -- tile indices (as made by string.pack('<I2I2...', ...)) whose length sets the tilemap's height.
+// function Tilemap:setTilesFromBytes(data, width)
+int oldCTilemapSetTilesFromBytes(lua_State* L)
+{
+    OldCTilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("OldCTilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    size_t length = 0;
+    const uint8_t* data = (const uint8_t*)pd->lua->getArgBytes(2, &length);
+    int width = pd->lua->getArgInt(3);
+
+    if ((data == NULL) || (width <= 0) || ((length % (width * 2)) != 0)) {
+        DM_LOG("OldCTilemap: Invalid arguments for setTilesFromBytes().");
+        return 0;
+    }
+
+    if (!oldCTilemapAllocateMap(this, width, (int)(length / (width * 2)))) {
+        return 0;
+    }
+
+    for (int y = 0; y < this->height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            oldCTilemapSetCell(this, x, y, (uint16_t)(data[0] | (data[1] << 8)));
+            data += 2;
+        }
+    }
+
+    return 0;
+}
+
+// -- Returns the content of the rectangle of tiles at (x, y) of size width x height as a string of little
+// -- endian 16 bit tile indices, row by row. The rectangle must be inside the tilemap.
+// function Tilemap:getTilesInRect(x, y, width, height)
+int oldCTilemapGetTilesInRect(lua_State* L)
+{
+    OldCTilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("OldCTilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    if (this->map == NULL) {
+        DM_LOG("OldCTilemap: Size of tilemap not set before getTilesInRect().");
+        return 0;
+    }
+
+    int x = pd->lua->getArgInt(2) - 1;
+    int y = pd->lua->getArgInt(3) - 1;
+    int width = pd->lua->getArgInt(4);
+    int height = pd->lua->getArgInt(5);
+
+    // -- Compared as distances to the edges so that a huge width or height can't overflow x + width.
+    if ((x < 0) || (y < 0) || (width <= 0) || (height <= 0) || (width > (this->width - x)) || (height > (this->height - y))) {
+        DM_LOG("OldCTilemap: Out of bounds rect %d,%d %dx%d for getTilesInRect().", x + 1, y + 1, width, height);
+        return 0;
+    }
+
+    uint8_t* data = dmMemoryCalloc(width * height, 2);
+    if (data == NULL) {
+        DM_LOG("OldCTilemap: Error allocating %d bytes for getTilesInRect().", width * height * 2);
+        return 0;
+    }
+
+    uint8_t* current = data;
+    for (int row = y; row < (y + height); ++row) {
+        const uint16_t* cells = this->map + (row * this->width) + x;
+        for (int column = 0; column < width; ++column) {
+            current[0] = (uint8_t)cells[column];
+            current[1] = (uint8_t)(cells[column] >> 8);
+            current += 2;
+        }
+    }
+
+    pd->lua->pushBytes((const char*)data, width * height * 2);
+
+    dmMemoryFree(data);
+
+    return 1;
+}
+
+// -- Sets the rectangle of tiles at (x, y) of size width x height from a string of little endian 16 bit tile
+// -- indices, row by row. Parts of the rectangle outside of the tilemap are ignored.
+// function Tilemap:setTilesInRect(x, y, width, height, data)
+int oldCTilemapSetTilesInRect(lua_State* L)
+{
+    OldCTilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("OldCTilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    if (this->map == NULL) {
+        DM_LOG("OldCTilemap: Size of tilemap not set before setTilesInRect().");
+        return 0;
+    }
+
+    int x = pd->lua->getArgInt(2) - 1;
+    int y = pd->lua->getArgInt(3) - 1;
+    int width = pd->lua->getArgInt(4);
+    int height = pd->lua->getArgInt(5);
+
+    size_t length = 0;
+    const uint8_t* data = (const uint8_t*)pd->lua->getArgBytes(6, &length);
+    // -- width * height * 2 can overflow an int, so length is divided by the size of a row instead.
+    size_t row_length = (size_t)width * 2;
+    if ((data == NULL) || (width <= 0) || (height <= 0) || ((length % row_length) != 0) || ((length / row_length) != (size_t)height)) {
+        DM_LOG("OldCTilemap: Invalid arguments for setTilesInRect().");
+        return 0;
+    }
+
+    int data_width = width;
+    int clipped_x = x;
+    int clipped_y = y;
+    if (!oldCTilemapClipRect(this, &clipped_x, &clipped_y, &width, &height)) {
+        return 0;
+    }
+
+    for (int row = 0; row < height; ++row) {
+        const uint8_t* current = data + ((((clipped_y - y) + row) * data_width) + (clipped_x - x)) * 2;
+        for (int column = 0; column < width; ++column) {
+            oldCTilemapSetCell(this, clipped_x + column, clipped_y + row, (uint16_t)(current[0] | (current[1] << 8)));
+            current += 2;
+        }
+    }
+
+    return 0;
+}
+
+// -- Sets all the tiles in the rectangle at (x, y) of size width x height to index. Parts of the rectangle
+// -- outside of the tilemap are ignored.
+// function Tilemap:fillRect(x, y, width, height, index)
+int oldCTilemapFillRect(lua_State* L)
+{
+    OldCTilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("OldCTilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    if (this->map == NULL) {
+        DM_LOG("OldCTilemap: Size of tilemap not set before fillRect().");
+        return 0;
+    }
+
+    int x = pd->lua->getArgInt(2) - 1;
+    int y = pd->lua->getArgInt(3) - 1;
+    int width = pd->lua->getArgInt(4);
+    int height = pd->lua->getArgInt(5);
+
+    int tilemap_index = pd->lua->getArgInt(6);
+    if ((tilemap_index < 0) || (tilemap_index > 0xFFFF)) {
+        DM_LOG("OldCTilemap: Out of bounds tile index %d for fillRect().", tilemap_index);
+        return 0;
+    }
+
+    if (!oldCTilemapClipRect(this, &x, &y, &width, &height)) {
+        return 0;
+    }
+
+    for (int row = y; row < (y + height); ++row) {
+        for (int column = x; column < (x + width); ++column) {
+            oldCTilemapSetCell(this, column, row, tilemap_index);
+        }
+    }
+
+    return 0;
+}
+
+// -- Copies the rectangle of tiles at (sourceX, sourceY) of size width x height in source, another dm.OldCTilemap
+// -- or this one, to (x, y) in this tilemap. Overlapping rectangles are handled and parts of either rectangle
+// -- outside of their tilemap are ignored.
+// function Tilemap:copyRect(source, sourceX, sourceY, width, height, x, y)
+int oldCTilemapCopyRect(lua_State* L)
+{
+    OldCTilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("OldCTilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    OldCTilemap* source = GET_TILEMAP_ARG(2);
+    if(source == NULL) {
+        DM_LOG("OldCTilemap: Error getting 'source' argument.");
+        return 0;
+    }
+
+    if ((this->map == NULL) || (source->map == NULL)) {
+        DM_LOG("OldCTilemap: Size of tilemap not set before copyRect().");
+        return 0;
+    }
+
+    int source_x = pd->lua->getArgInt(3) - 1;
+    int source_y = pd->lua->getArgInt(4) - 1;
+    int width = pd->lua->getArgInt(5);
+    int height = pd->lua->getArgInt(6);
+    int x = pd->lua->getArgInt(7) - 1;
+    int y = pd->lua->getArgInt(8) - 1;
+
+    // -- Clip against the source first, then move the result over to the destination and clip again.
+    int clipped_x = source_x;
+    int clipped_y = source_y;
+    if (!oldCTilemapClipRect(source, &clipped_x, &clipped_y, &width, &height)) {
+        return 0;
+    }
+
+    x += clipped_x - source_x;
+    y += clipped_y - source_y;
+    source_x = clipped_x;
+    source_y = clipped_y;
+
+    clipped_x = x;
+    clipped_y = y;
+    if (!oldCTilemapClipRect(this, &clipped_x, &clipped_y, &width, &height)) {
+        return 0;
+    }
+
+    source_x += clipped_x - x;
+    source_y += clipped_y - y;
+    x = clipped_x;
+    y = clipped_y;
+
+    // -- Walk the rectangle backwards when copying within the same map towards higher coordinates.
+    int step_x = ((source == this) && (x > source_x)) ? -1 : 1;
+    int step_y = ((source == this) && (y > source_y)) ? -1 : 1;
+
+    for (int row_index = 0; row_index < height; ++row_index) {
+        int row = (step_y > 0) ? row_index : (height - 1 - row_index);
+        const uint16_t* source_cells = source->map + ((source_y + row) * source->width) + source_x;
+        for (int column_index = 0; column_index < width; ++column_index) {
+            int column = (step_x > 0) ? column_index : (width - 1 - column_index);
+            oldCTilemapSetCell(this, x + column, y + row, source_cells[column]);
+        }
+    }
+
+    return 0;
+}
+
 // -- Sets the tilemap’s width and height, in number of tiles.
 // function Tilemap:setSize(width, height)
 int oldCTilemapSetSize(lua_State* L)
@@ -307,24 +660,44 @@ int oldCTilemapSetSize(lua_State* L)
         return 0;
     }
 
-    if (this->map != NULL) {
-        dmMemoryFree(this->map);
-        this->map = NULL;
-    }
-    
-    this->width = pd->lua->getArgInt(2);
-    this->height = pd->lua->getArgInt(3);
+    oldCTilemapAllocateMap(this, pd->lua->getArgInt(2), pd->lua->getArgInt(3));
 
-    if ((this->width == 0) || (this->width > 2048) || (this->height == 0) || (this->height > 2048)) {
-        DM_LOG("OldCTilemap: Trying to set an invalid size of %dx%d.", this->width, this->height);
+    return 0;
+}
+
+// -- Enables or disables drawing tiles by writing straight into the frame buffer instead of calling drawBitmap().
+// -- The output is identical as long as the draw mode is kDrawModeCopy and no stencil is set. Direct drawing
+// -- always targets the screen, even if an image context was pushed.
+// function Tilemap:setDirectDraw(enabled)
+int oldCTilemapSetDirectDraw(lua_State* L)
+{
+    OldCTilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("OldCTilemap: Error getting 'self' argument.");
         return 0;
     }
 
-    this->map = dmMemoryCalloc(this->width * this->height, sizeof(uint16_t));
+    this->direct_draw = pd->lua->getArgBool(2);
 
     return 0;
 }
 
+// -- Returns how sparse the map is as multiple values (occupiedCells, totalCells).
+// function Tilemap:getOccupancyStats()
+int oldCTilemapGetOccupancyStats(lua_State* L)
+{
+    OldCTilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("OldCTilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    pd->lua->pushInt(this->occupancy.nb_of_occupied_cells);
+    pd->lua->pushInt(this->width * this->height);
+
+    return 2;
+}
+
 // -- Returns the size of the tile map, in tiles, as a pair, (width, height).
 // function Tilemap:getSize()
 int oldCTilemapGetSize(lua_State* L)
@@ -381,10 +754,17 @@ static const lua_reg oldCTilemapClass[] = {
     { "draw", oldCTilemapDraw },
     { "setTileAtPosition", oldCTilemapSetTileAtPosition },
     { "getTileAtPosition", oldCTilemapGetTileAtPosition },
+    { "setTilesFromBytes", oldCTilemapSetTilesFromBytes },
+    { "getTilesInRect", oldCTilemapGetTilesInRect },
+    { "setTilesInRect", oldCTilemapSetTilesInRect },
+    { "fillRect", oldCTilemapFillRect },
+    { "copyRect", oldCTilemapCopyRect },
     { "setSize", oldCTilemapSetSize },
     { "getSize", oldCTilemapGetSize },
     { "getPixelSize", oldCTilemapGetPixelSize },
     { "getTileSize", oldCTilemapGetTileSize },
+    { "setDirectDraw", oldCTilemapSetDirectDraw },
+    { "getOccupancyStats", oldCTilemapGetOccupancyStats },
     
     { NULL, NULL }
 };
@@ -0,0 +1,457 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#include "Tilemap/Pathfinding.h"
+
+#define DM_LOG_ENABLE
+#include "pdbase/pdbase.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// -- Constants
+#define PATHFINDING_STRAIGHT_COST 10
+#define PATHFINDING_DIAGONAL_COST 14
+#define PATHFINDING_FLOW_GOAL 9
+
+// -- Neighbour offsets, the four straight ones first.
+static const int pathfindingOffsets[8][2] = {
+    { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 },
+    { 1, 1 }, { -1, 1 }, { 1, -1 }, { -1, -1 }
+};
+
+// -- Free the search buffers.
+static void pathfindingFreeBuffers(Pathfinding* this)
+{
+    arenaFree(this->arena, this->costs);
+    arenaFree(this->arena, this->scores);
+    arenaFree(this->arena, this->parents);
+    arenaFree(this->arena, this->heap_indices);
+    arenaFree(this->arena, this->stamps);
+    arenaFree(this->arena, this->heap);
+    arenaFree(this->arena, this->flow);
+
+    this->costs = NULL;
+    this->scores = NULL;
+    this->parents = NULL;
+    this->heap_indices = NULL;
+    this->stamps = NULL;
+    this->heap = NULL;
+    this->flow = NULL;
+
+    this->nb_of_cells = 0;
+    this->path_length = 0;
+    this->path = NULL;
+}
+
+// -- Allocate path finding for a tileset of nb_of_tiles images. Empty cells cost 1 to walk into and every tile
+// -- starts off impassable. Everything is allocated in arena, or on the heap if arena is NULL.
+Pathfinding* pathfindingNew(int nb_of_tiles, Arena* arena)
+{
+    Pathfinding* this = arenaCalloc(arena, 1, sizeof(Pathfinding));
+    if (this == NULL) {
+        return NULL;
+    }
+
+    this->arena = arena;
+
+    this->tile_costs = arenaCalloc(this->arena, nb_of_tiles + 1, sizeof(uint8_t));
+    if (this->tile_costs == NULL) {
+        DM_LOG("Pathfinding: Error allocating tile costs for %d tiles.", nb_of_tiles);
+        arenaFree(arena, this);
+        return NULL;
+    }
+
+    this->nb_of_tiles = nb_of_tiles;
+    this->tile_costs[0] = 1;
+    this->min_tile_cost = 1;
+
+    return this;
+}
+
+void pathfindingDelete(Pathfinding* this)
+{
+    pathfindingFreeBuffers(this);
+
+    arenaFree(this->arena, this->tile_costs);
+    Arena* arena = this->arena;
+    arenaFree(arena, this);
+}
+
+// -- Search map from now on, (re)allocating the search buffers if its size changed. Returns 0 on error or if the map
+// -- has more than PATHFINDING_MAX_NB_OF_CELLS cells.
+int pathfindingSetMap(Pathfinding* this, const TileStorage* map)
+{
+    this->map = NULL;
+
+    if (map == NULL) {
+        pathfindingFreeBuffers(this);
+        return 1;
+    }
+
+    int nb_of_cells = map->width * map->height;
+    if (nb_of_cells > PATHFINDING_MAX_NB_OF_CELLS) {
+        DM_LOG("Pathfinding: Map of %dx%d is too big, searches are limited to %d cells.", map->width, map->height,
+               PATHFINDING_MAX_NB_OF_CELLS);
+        pathfindingFreeBuffers(this);
+        return 0;
+    }
+
+    if (nb_of_cells != this->nb_of_cells) {
+        pathfindingFreeBuffers(this);
+
+        this->costs = arenaCalloc(this->arena, nb_of_cells, sizeof(uint32_t));
+        this->scores = arenaCalloc(this->arena, nb_of_cells, sizeof(uint32_t));
+        this->parents = arenaCalloc(this->arena, nb_of_cells, sizeof(int32_t));
+        this->heap_indices = arenaCalloc(this->arena, nb_of_cells, sizeof(int32_t));
+        this->stamps = arenaCalloc(this->arena, nb_of_cells, sizeof(uint32_t));
+        this->heap = arenaCalloc(this->arena, nb_of_cells, sizeof(uint32_t));
+        this->flow = arenaCalloc(this->arena, nb_of_cells, sizeof(uint8_t));
+
+        if ((this->costs == NULL) || (this->scores == NULL) || (this->parents == NULL) || (this->heap_indices == NULL) ||
+            (this->stamps == NULL) || (this->heap == NULL) || (this->flow == NULL)) {
+            DM_LOG("Pathfinding: Error allocating search buffers for %d cells.", nb_of_cells);
+            pathfindingFreeBuffers(this);
+            return 0;
+        }
+
+        this->nb_of_cells = nb_of_cells;
+        this->stamp = 0;
+    }
+    else {
+        memset(this->flow, 0, nb_of_cells);
+    }
+
+    this->map = map;
+    this->path_length = 0;
+
+    return 1;
+}
+
+// -- Set the cost of walking into cells set to index, 0 making them impassable. Returns 0 if index is invalid.
+int pathfindingSetTileCost(Pathfinding* this, int index, int cost)
+{
+    if ((index < 0) || (index > this->nb_of_tiles) || (cost < 0) || (cost > 255)) {
+        return 0;
+    }
+
+    this->tile_costs[index] = (uint8_t)cost;
+
+    // -- The heuristic must never overestimate so it is scaled by the cheapest cost.
+    this->min_tile_cost = 255;
+    for (int i = 0; i <= this->nb_of_tiles; ++i) {
+        if ((this->tile_costs[i] != 0) && (this->tile_costs[i] < this->min_tile_cost)) {
+            this->min_tile_cost = this->tile_costs[i];
+        }
+    }
+
+    return 1;
+}
+
+// -- Cost of walking into cell (x, y), whichever way it is flipped, 0 if it is impassable or outside of the map.
+static inline int pathfindingCellCost(const Pathfinding* this, int x, int y)
+{
+    if ((x < 0) || (y < 0) || (x >= this->map->width) || (y >= this->map->height)) {
+        return 0;
+    }
+
+    uint16_t value = tileStorageGet(this->map, x, y) & TILE_STORAGE_INDEX_MASK;
+
+    return (value <= this->nb_of_tiles) ? this->tile_costs[value] : 0;
+}
+
+// -- Start a new search, making every cell unreached without having to clear the search buffers.
+static void pathfindingStartSearch(Pathfinding* this)
+{
+    if (++this->stamp == 0) {
+        memset(this->stamps, 0, this->nb_of_cells * sizeof(uint32_t));
+        this->stamp = 1;
+    }
+
+    this->heap_size = 0;
+}
+
+static inline void pathfindingHeapSwap(Pathfinding* this, int a, int b)
+{
+    uint32_t cell = this->heap[a];
+    this->heap[a] = this->heap[b];
+    this->heap[b] = cell;
+
+    this->heap_indices[this->heap[a]] = a;
+    this->heap_indices[this->heap[b]] = b;
+}
+
+static void pathfindingHeapUp(Pathfinding* this, int index)
+{
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (this->scores[this->heap[parent]] <= this->scores[this->heap[index]]) {
+            break;
+        }
+
+        pathfindingHeapSwap(this, parent, index);
+        index = parent;
+    }
+}
+
+static uint32_t pathfindingHeapPop(Pathfinding* this)
+{
+    uint32_t cell = this->heap[0];
+    this->heap_indices[cell] = -1;
+
+    --this->heap_size;
+    if (this->heap_size > 0) {
+        this->heap[0] = this->heap[this->heap_size];
+        this->heap_indices[this->heap[0]] = 0;
+
+        int index = 0;
+        for (;;) {
+            int smallest = index;
+            int left = (index * 2) + 1;
+            int right = left + 1;
+
+            if ((left < this->heap_size) && (this->scores[this->heap[left]] < this->scores[this->heap[smallest]])) {
+                smallest = left;
+            }
+
+            if ((right < this->heap_size) && (this->scores[this->heap[right]] < this->scores[this->heap[smallest]])) {
+                smallest = right;
+            }
+
+            if (smallest == index) {
+                break;
+            }
+
+            pathfindingHeapSwap(this, index, smallest);
+            index = smallest;
+        }
+    }
+
+    return cell;
+}
+
+// -- Record that cell can be reached with cost, coming from parent, if that is cheaper than what was known so far.
+static inline void pathfindingRelax(Pathfinding* this, uint32_t cell, uint32_t cost, uint32_t score, int32_t parent)
+{
+    if (this->stamps[cell] != this->stamp) {
+        this->stamps[cell] = this->stamp;
+        this->heap_indices[cell] = this->heap_size;
+        this->heap[this->heap_size++] = cell;
+    }
+    else if ((this->heap_indices[cell] < 0) || (cost >= this->costs[cell])) {
+        // -- Already settled or not any cheaper.
+        return;
+    }
+
+    this->costs[cell] = cost;
+    this->scores[cell] = score;
+    this->parents[cell] = parent;
+
+    pathfindingHeapUp(this, this->heap_indices[cell]);
+}
+
+// -- Return the cost of stepping from (x, y) in direction, or 0 if that isn't possible. Diagonal steps can't cut
+// -- corners. When searching backwards the step is taken from the neighbour into (x, y) so that is the cost paid.
+static inline uint32_t pathfindingStepCost(const Pathfinding* this, int x, int y, int direction, int backwards)
+{
+    int dx = pathfindingOffsets[direction][0];
+    int dy = pathfindingOffsets[direction][1];
+
+    int cost = backwards ? pathfindingCellCost(this, x, y) : pathfindingCellCost(this, x + dx, y + dy);
+    if ((cost == 0) || (backwards && (pathfindingCellCost(this, x + dx, y + dy) == 0))) {
+        return 0;
+    }
+
+    if (direction < 4) {
+        return (uint32_t)cost * PATHFINDING_STRAIGHT_COST;
+    }
+
+    if ((pathfindingCellCost(this, x + dx, y) == 0) || (pathfindingCellCost(this, x, y + dy) == 0)) {
+        return 0;
+    }
+
+    return (uint32_t)cost * PATHFINDING_DIAGONAL_COST;
+}
+
+// -- Estimated cost from (x, y) to the goal, never more than the actual cost.
+static inline uint32_t pathfindingHeuristic(const Pathfinding* this, int x, int y, int goal_x, int goal_y, int diagonals)
+{
+    uint32_t dx = (uint32_t)abs(goal_x - x);
+    uint32_t dy = (uint32_t)abs(goal_y - y);
+
+    if (!diagonals) {
+        return (dx + dy) * PATHFINDING_STRAIGHT_COST * this->min_tile_cost;
+    }
+
+    uint32_t smallest = (dx < dy) ? dx : dy;
+    uint32_t largest = (dx < dy) ? dy : dx;
+
+    return ((largest * PATHFINDING_STRAIGHT_COST) + (smallest * (PATHFINDING_DIAGONAL_COST - PATHFINDING_STRAIGHT_COST))) *
+           this->min_tile_cost;
+}
+
+// -- Find the cheapest path between two cells, 0-based, with A*. The path is stored in this->path and its length,
+// -- including both ends, is returned. Returns 0 if there is no path.
+int pathfindingFindPath(Pathfinding* this, int start_x, int start_y, int goal_x, int goal_y, int diagonals)
+{
+    this->path_length = 0;
+
+    if ((this->map == NULL) || (pathfindingCellCost(this, start_x, start_y) == 0) ||
+        (pathfindingCellCost(this, goal_x, goal_y) == 0)) {
+        return 0;
+    }
+
+    int width = this->map->width;
+    uint32_t goal = (uint32_t)((goal_y * width) + goal_x);
+    int nb_of_directions = diagonals ? 8 : 4;
+
+    pathfindingStartSearch(this);
+    pathfindingRelax(this, (uint32_t)((start_y * width) + start_x), 0,
+                     pathfindingHeuristic(this, start_x, start_y, goal_x, goal_y, diagonals), -1);
+
+    while (this->heap_size > 0) {
+        uint32_t cell = pathfindingHeapPop(this);
+        if (cell == goal) {
+            break;
+        }
+
+        int x = (int)(cell % width);
+        int y = (int)(cell / width);
+
+        for (int direction = 0; direction < nb_of_directions; ++direction) {
+            uint32_t step_cost = pathfindingStepCost(this, x, y, direction, 0);
+            if (step_cost == 0) {
+                continue;
+            }
+
+            int next_x = x + pathfindingOffsets[direction][0];
+            int next_y = y + pathfindingOffsets[direction][1];
+            uint32_t cost = this->costs[cell] + step_cost;
+
+            pathfindingRelax(this, (uint32_t)((next_y * width) + next_x), cost,
+                             cost + pathfindingHeuristic(this, next_x, next_y, goal_x, goal_y, diagonals), (int32_t)cell);
+        }
+    }
+
+    if ((this->stamps[goal] != this->stamp) || (this->heap_indices[goal] >= 0)) {
+        return 0;
+    }
+
+    // -- The search is over so the heap's memory, 4 bytes per cell, is reused to store the path.
+    int path_length = 0;
+    for (int32_t cell = (int32_t)goal; cell >= 0; cell = this->parents[cell]) {
+        ++path_length;
+    }
+
+    uint8_t* path = (uint8_t*)this->heap;
+    int index = path_length;
+    for (int32_t cell = (int32_t)goal; cell >= 0; cell = this->parents[cell]) {
+        uint8_t* current = path + (--index * 4);
+        int x = (cell % width) + 1;
+        int y = (cell / width) + 1;
+
+        current[0] = (uint8_t)x;
+        current[1] = (uint8_t)(x >> 8);
+        current[2] = (uint8_t)y;
+        current[3] = (uint8_t)(y >> 8);
+    }
+
+    this->path = path;
+    this->path_length = path_length;
+
+    return path_length;
+}
+
+// -- Compute, with Dijkstra's algorithm from the goal, in which direction to walk from every cell to reach the goal,
+// -- 0-based, as cheaply as possible. Returns the number of cells the goal can be reached from.
+int pathfindingComputeFlowField(Pathfinding* this, int goal_x, int goal_y, int diagonals)
+{
+    if (this->map == NULL) {
+        return 0;
+    }
+
+    memset(this->flow, 0, this->nb_of_cells);
+    this->path_length = 0;
+
+    if (pathfindingCellCost(this, goal_x, goal_y) == 0) {
+        return 0;
+    }
+
+    int width = this->map->width;
+    int nb_of_directions = diagonals ? 8 : 4;
+    int nb_of_reached_cells = 0;
+
+    pathfindingStartSearch(this);
+    pathfindingRelax(this, (uint32_t)((goal_y * width) + goal_x), 0, 0, -1);
+
+    while (this->heap_size > 0) {
+        uint32_t cell = pathfindingHeapPop(this);
+        ++nb_of_reached_cells;
+
+        int x = (int)(cell % width);
+        int y = (int)(cell / width);
+
+        for (int direction = 0; direction < nb_of_directions; ++direction) {
+            // -- Walking backwards, from the neighbour into this cell.
+            uint32_t step_cost = pathfindingStepCost(this, x, y, direction, 1);
+            if (step_cost == 0) {
+                continue;
+            }
+
+            int next_x = x + pathfindingOffsets[direction][0];
+            int next_y = y + pathfindingOffsets[direction][1];
+            uint32_t cost = this->costs[cell] + step_cost;
+
+            pathfindingRelax(this, (uint32_t)((next_y * width) + next_x), cost, cost, (int32_t)cell);
+        }
+    }
+
+    for (int cell = 0; cell < this->nb_of_cells; ++cell) {
+        if ((this->stamps[cell] != this->stamp) || (this->heap_indices[cell] >= 0)) {
+            continue;
+        }
+
+        int32_t parent = this->parents[cell];
+        if (parent < 0) {
+            this->flow[cell] = PATHFINDING_FLOW_GOAL;
+            continue;
+        }
+
+        int dx = (parent % width) - (cell % width);
+        int dy = (parent / width) - (cell / width);
+        for (int direction = 0; direction < 8; ++direction) {
+            if ((pathfindingOffsets[direction][0] == dx) && (pathfindingOffsets[direction][1] == dy)) {
+                this->flow[cell] = (uint8_t)(direction + 1);
+                break;
+            }
+        }
+    }
+
+    return nb_of_reached_cells;
+}
+
+// -- Get the direction to walk in from cell (x, y), 0-based, according to the last flow field. Returns 0 if the goal
+// -- can't be reached from there, in which case dx and dy are left untouched.
+int pathfindingGetFlowDirection(const Pathfinding* this, int x, int y, int* dx, int* dy)
+{
+    if ((this->map == NULL) || (x < 0) || (y < 0) || (x >= this->map->width) || (y >= this->map->height)) {
+        return 0;
+    }
+
+    uint8_t flow = this->flow[(y * this->map->width) + x];
+    if (flow == 0) {
+        return 0;
+    }
+
+    if (flow == PATHFINDING_FLOW_GOAL) {
+        *dx = 0;
+        *dy = 0;
+    }
+    else {
+        *dx = pathfindingOffsets[flow - 1][0];
+        *dy = pathfindingOffsets[flow - 1][1];
+    }
+
+    return 1;
+}
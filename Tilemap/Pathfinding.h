@@ -0,0 +1,56 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef DM_PATHFINDING_H
+#define DM_PATHFINDING_H
+
+#include "pd_api.h"
+
+#include "Tilemap/TileStorage.h"
+
+// -- Searches need 25 bytes for every cell of the map, so maps with more than PATHFINDING_MAX_NB_OF_CELLS cells
+// -- (512 x 512, about 6.5MB of buffers) are refused.
+#define PATHFINDING_MAX_NB_OF_CELLS (512 * 512)
+
+// -- Path and flow field searches over a map, where each tile index has a cost to walk into. Every buffer a search
+// -- needs is allocated once for the map's size and reused so searching never allocates.
+typedef struct {
+    Arena* arena;
+    const TileStorage* map;
+
+    // -- tile_costs[index] is the cost of walking into a cell set to index, 0 if it can't be walked into.
+    int nb_of_tiles;
+    uint8_t* tile_costs;
+    int min_tile_cost;
+
+    // -- Search buffers, one entry per cell. Cells whose stamp isn't the current one haven't been reached yet.
+    int nb_of_cells;
+    uint32_t* costs;
+    uint32_t* scores;
+    int32_t* parents;
+    int32_t* heap_indices;
+    uint32_t* stamps;
+    uint32_t stamp;
+
+    int heap_size;
+    uint32_t* heap;
+
+    // -- Last path found, as little endian 16 bit (x, y) pairs, 1-based, stored in the heap's memory.
+    int path_length;
+    const uint8_t* path;
+
+    // -- Last flow field computed, flow[cell] is 0 if the goal can't be reached, 9 for the goal itself or the
+    // -- direction to walk in plus 1.
+    uint8_t* flow;
+} Pathfinding;
+
+extern Pathfinding* pathfindingNew(int nb_of_tiles, Arena* arena);
+extern void pathfindingDelete(Pathfinding* this);
+extern int pathfindingSetMap(Pathfinding* this, const TileStorage* map);
+extern int pathfindingSetTileCost(Pathfinding* this, int index, int cost);
+extern int pathfindingFindPath(Pathfinding* this, int start_x, int start_y, int goal_x, int goal_y, int diagonals);
+extern int pathfindingComputeFlowField(Pathfinding* this, int goal_x, int goal_y, int diagonals);
+extern int pathfindingGetFlowDirection(const Pathfinding* this, int x, int y, int* dx, int* dy);
+
+#endif
@@ -0,0 +1,173 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#include "Tilemap/TileStorage.h"
+
+#define DM_LOG_ENABLE
+#include "pdbase/pdbase.h"
+
+#include <string.h>
+
+// -- Constants
+#define TILE_STORAGE_NB_OF_CHUNK_CELLS (TILE_STORAGE_CHUNK_SIZE * TILE_STORAGE_CHUNK_SIZE)
+
+// -- Allocate an empty map of width x height cells. Only the chunk table is allocated up front. Everything is
+// -- allocated in arena, or on the heap if arena is NULL.
+TileStorage* tileStorageNew(int width, int height, Arena* arena)
+{
+    TileStorage* this = arenaCalloc(arena, 1, sizeof(TileStorage));
+    if (this == NULL) {
+        return NULL;
+    }
+
+    this->arena = arena;
+    this->width = width;
+    this->height = height;
+    this->compact = 1;
+    this->chunks_wide = (width + TILE_STORAGE_CHUNK_MASK) >> TILE_STORAGE_CHUNK_SHIFT;
+    this->chunks_high = (height + TILE_STORAGE_CHUNK_MASK) >> TILE_STORAGE_CHUNK_SHIFT;
+
+    this->chunks = arenaCalloc(this->arena, this->chunks_wide * this->chunks_high, sizeof(TileChunk*));
+    if (this->chunks == NULL) {
+        DM_LOG("TileStorage: Error allocating chunk table for %dx%d cells.", width, height);
+        arenaFree(arena, this);
+        return NULL;
+    }
+
+    return this;
+}
+
+void tileStorageDelete(TileStorage* this)
+{
+    int nb_of_chunks = this->chunks_wide * this->chunks_high;
+    for (int i = 0; i < nb_of_chunks; ++i) {
+        if (this->chunks[i] != NULL) {
+            arenaFree(this->arena, this->chunks[i]);
+        }
+    }
+
+    Arena* arena = this->arena;
+    arenaFree(arena, this->chunks);
+    arenaFree(arena, this);
+}
+
+// -- Size of a chunk, which depends on how many bytes each cell takes.
+static size_t tileStorageChunkSize(const TileStorage* this)
+{
+    return sizeof(TileChunk) + (TILE_STORAGE_NB_OF_CHUNK_CELLS * (this->compact ? sizeof(uint8_t) : sizeof(uint16_t)));
+}
+
+// -- Switch to two bytes per cell, reallocating every chunk. Returns 0 on error, in which case nothing changed.
+static int tileStorageWiden(TileStorage* this)
+{
+    int nb_of_chunks = this->chunks_wide * this->chunks_high;
+
+    // -- Allocate everything first so a failure leaves the storage untouched.
+    TileChunk** wide_chunks = arenaCalloc(this->arena, nb_of_chunks, sizeof(TileChunk*));
+    if (wide_chunks == NULL) {
+        DM_LOG("TileStorage: Error allocating chunk table to widen %dx%d cells.", this->width, this->height);
+        return 0;
+    }
+
+    size_t wide_chunk_size = sizeof(TileChunk) + (TILE_STORAGE_NB_OF_CHUNK_CELLS * sizeof(uint16_t));
+
+    for (int i = 0; i < nb_of_chunks; ++i) {
+        const TileChunk* chunk = this->chunks[i];
+        if (chunk == NULL) {
+            continue;
+        }
+
+        TileChunk* wide_chunk = arenaCalloc(this->arena, 1, wide_chunk_size);
+        if (wide_chunk == NULL) {
+            DM_LOG("TileStorage: Error allocating chunk to widen %dx%d cells.", this->width, this->height);
+
+            for (int j = 0; j < i; ++j) {
+                arenaFree(this->arena, wide_chunks[j]);
+            }
+
+            arenaFree(this->arena, wide_chunks);
+            return 0;
+        }
+
+        memcpy(wide_chunk->row_occupancy, chunk->row_occupancy, sizeof(chunk->row_occupancy));
+        wide_chunk->nb_of_occupied_cells = chunk->nb_of_occupied_cells;
+
+        const uint8_t* cells = (const uint8_t*)chunk->cells;
+        for (int cell = 0; cell < TILE_STORAGE_NB_OF_CHUNK_CELLS; ++cell) {
+            wide_chunk->cells[cell] = cells[cell];
+        }
+
+        wide_chunks[i] = wide_chunk;
+    }
+
+    for (int i = 0; i < nb_of_chunks; ++i) {
+        arenaFree(this->arena, this->chunks[i]);
+    }
+
+    arenaFree(this->arena, this->chunks);
+
+    this->chunks = wide_chunks;
+    this->compact = 0;
+
+    return 1;
+}
+
+// -- Set the value of cell (x, y), 0-based. Chunks are allocated on their first non-empty cell and freed
+// -- when their last one is cleared. Returns 0 if a chunk could not be allocated.
+int tileStorageSet(TileStorage* this, int x, int y, uint16_t value)
+{
+    if (this->compact && (value > TILE_STORAGE_COMPACT_MAX) && !tileStorageWiden(this)) {
+        return 0;
+    }
+
+    int chunk_index = ((y >> TILE_STORAGE_CHUNK_SHIFT) * this->chunks_wide) + (x >> TILE_STORAGE_CHUNK_SHIFT);
+    TileChunk* chunk = this->chunks[chunk_index];
+
+    if (chunk == NULL) {
+        if (value == 0) {
+            return 1;
+        }
+
+        chunk = arenaCalloc(this->arena, 1, tileStorageChunkSize(this));
+        if (chunk == NULL) {
+            DM_LOG("TileStorage: Error allocating chunk for cell %d,%d.", x, y);
+            return 0;
+        }
+
+        this->chunks[chunk_index] = chunk;
+        ++this->nb_of_allocated_chunks;
+    }
+
+    int local_x = x & TILE_STORAGE_CHUNK_MASK;
+    int local_y = y & TILE_STORAGE_CHUNK_MASK;
+    int cell_index = (local_y << TILE_STORAGE_CHUNK_SHIFT) + local_x;
+    uint16_t cell = tileStorageGetChunkCell(this, chunk, cell_index);
+    uint32_t bit = 1u << local_x;
+
+    if ((cell == 0) && (value != 0)) {
+        chunk->row_occupancy[local_y] |= bit;
+        ++chunk->nb_of_occupied_cells;
+        ++this->nb_of_occupied_cells;
+    }
+    else if ((cell != 0) && (value == 0)) {
+        chunk->row_occupancy[local_y] &= ~bit;
+        --chunk->nb_of_occupied_cells;
+        --this->nb_of_occupied_cells;
+    }
+
+    if (this->compact) {
+        ((uint8_t*)chunk->cells)[cell_index] = (uint8_t)value;
+    }
+    else {
+        chunk->cells[cell_index] = value;
+    }
+
+    if (chunk->nb_of_occupied_cells == 0) {
+        arenaFree(this->arena, chunk);
+        this->chunks[chunk_index] = NULL;
+        --this->nb_of_allocated_chunks;
+    }
+
+    return 1;
+}
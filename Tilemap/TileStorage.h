@@ -0,0 +1,78 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef DM_TILESTORAGE_H
+#define DM_TILESTORAGE_H
+
+#include "pd_api.h"
+
+#include "Tilemap/Arena.h"
+
+// -- Maps are stored as square chunks of 32x32 cells so that each chunk row's occupancy fits in one word.
+#define TILE_STORAGE_CHUNK_SHIFT    5
+#define TILE_STORAGE_CHUNK_SIZE     (1 << TILE_STORAGE_CHUNK_SHIFT)
+#define TILE_STORAGE_CHUNK_MASK     (TILE_STORAGE_CHUNK_SIZE - 1)
+
+// -- Cell values hold a 1-based image index, 0 for an empty cell, in their low bits and an LCDBitmapFlip to draw
+// -- the image with in their two high bits.
+#define TILE_STORAGE_INDEX_MASK     0x3FFF
+#define TILE_STORAGE_FLIP_SHIFT     14
+
+// -- Maximum value stored while the storage is compact.
+#define TILE_STORAGE_COMPACT_MAX    0xFF
+
+typedef struct {
+    // -- Bit x of row_occupancy[y] is set if cell (x, y) of the chunk is not empty.
+    uint32_t row_occupancy[TILE_STORAGE_CHUNK_SIZE];
+    int nb_of_occupied_cells;
+
+    // -- TILE_STORAGE_CHUNK_SIZE x TILE_STORAGE_CHUNK_SIZE cells, stored as bytes if the storage is compact.
+    uint16_t cells[];
+} TileChunk;
+
+// -- Sparse map storage where chunks containing only empty cells are not allocated at all. Maps start off compact,
+// -- storing one byte per cell, and are widened to two bytes per cell the first time a value doesn't fit.
+typedef struct {
+    Arena* arena;
+
+    int width;
+    int height;
+    int compact;
+
+    int chunks_wide;
+    int chunks_high;
+    TileChunk** chunks;
+
+    int nb_of_allocated_chunks;
+    int nb_of_occupied_cells;
+} TileStorage;
+
+extern TileStorage* tileStorageNew(int width, int height, Arena* arena);
+extern void tileStorageDelete(TileStorage* this);
+extern int tileStorageSet(TileStorage* this, int x, int y, uint16_t value);
+
+// -- Returns the chunk at chunk coordinates (chunk_x, chunk_y), or NULL if all its cells are empty.
+static inline TileChunk* tileStorageGetChunk(const TileStorage* this, int chunk_x, int chunk_y)
+{
+    return this->chunks[(chunk_y * this->chunks_wide) + chunk_x];
+}
+
+// -- Returns the value of cell index in chunk.
+static inline uint16_t tileStorageGetChunkCell(const TileStorage* this, const TileChunk* chunk, int index)
+{
+    return this->compact ? ((const uint8_t*)chunk->cells)[index] : chunk->cells[index];
+}
+
+// -- Returns the value of cell (x, y), 0-based. Coordinates must be inside the map.
+static inline uint16_t tileStorageGet(const TileStorage* this, int x, int y)
+{
+    TileChunk* chunk = tileStorageGetChunk(this, x >> TILE_STORAGE_CHUNK_SHIFT, y >> TILE_STORAGE_CHUNK_SHIFT);
+    if (chunk == NULL) {
+        return 0;
+    }
+
+    return tileStorageGetChunkCell(this, chunk, ((y & TILE_STORAGE_CHUNK_MASK) << TILE_STORAGE_CHUNK_SHIFT) + (x & TILE_STORAGE_CHUNK_MASK));
+}
+
+#endif
@@ -4,305 +4,2885 @@
 
 #include "Tilemap/Tilemap.h"
 #include "Tilemap/OldCTilemap.h"
+#include "Tilemap/TilemapLayers.h"
+#include "Tilemap/TilemapArena.h"
+#include "Tilemap/MapFile.h"
 
 #define DM_LOG_ENABLE
 #include "pdbase/pdbase.h"
 
+#include <string.h>
+#include <math.h>
+
 // -- Forward declaration
 static const lua_reg tilemapClass[];
 
-// -- Constants
-#define CLASSNAME_TILEMAP "dm.Tilemap"
+// -- Constants
+#define TILEMAP_MAX_SIZE 16384
+#define TILEMAP_DEFAULT_PRESHIFT_BUDGET (64 * 1024)
+#define TILEMAP_LOAD_CELLS_PER_BATCH 2048
+#define TILEMAP_MAX_OVERVIEW_SCALE 8
+#define TILEMAP_MAX_OVERVIEW_SIZE 2048
+
+// -- Get an argument as a Tilemap class
+#define GET_TILEMAP_ARG(index)    pd->lua->getArgObject(index, CLASSNAME_TILEMAP, NULL);
+
+// -- Register the class
+extern void register_Tilemap(PlaydateAPI* api)
+{
+    const char* err = NULL;
+    
+    // -- Register Tilemap
+    if (!pd->lua->registerClass(CLASSNAME_TILEMAP, tilemapClass, NULL, 0, &err))
+    {
+        DM_LOG("dm.Tilemap: Failed to register the Tilemap class (%s).", err);
+        return;
+    }
+    
+    register_OldCTilemap(api);
+    register_TilemapLayers(api);
+    register_TilemapArena(api);
+}
+
+// -- Divide rounding towards negative infinity, needed when the tilemap is scrolled past the screen's origin.
+static inline int tilemapFloorDiv(int value, int divisor)
+{
+    return (value >= 0) ? (value / divisor) : -((-value + divisor - 1) / divisor);
+}
+
+// -- Return 1 if the screen rectangle [left, right[ x [top, bottom[ is entirely covered by opaque tiles from any
+// -- single one of the occluders.
+int tilemapIsOccluded(const TilemapOccluder* occluders, int nb_of_occluders, int left, int top, int right, int bottom)
+{
+    for (int i = 0; i < nb_of_occluders; ++i) {
+        const Tilemap* tilemap = occluders[i].tilemap;
+        if (tilemap->map == NULL) {
+            continue;
+        }
+
+        int first_tile_x = tilemapFloorDiv(left - occluders[i].x, tilemap->tile_width);
+        int first_tile_y = tilemapFloorDiv(top - occluders[i].y, tilemap->tile_height);
+        int last_tile_x = tilemapFloorDiv(right - 1 - occluders[i].x, tilemap->tile_width);
+        int last_tile_y = tilemapFloorDiv(bottom - 1 - occluders[i].y, tilemap->tile_height);
+
+        if ((first_tile_x < 0) || (first_tile_y < 0) || (last_tile_x >= tilemap->width) || (last_tile_y >= tilemap->height)) {
+            continue;
+        }
+
+        int covered = 1;
+        for (int tile_y = first_tile_y; covered && (tile_y <= last_tile_y); ++tile_y) {
+            for (int tile_x = first_tile_x; covered && (tile_x <= last_tile_x); ++tile_x) {
+                unsigned int index = (unsigned int)(tileStorageGet(tilemap->map, tile_x, tile_y) & TILE_STORAGE_INDEX_MASK) - 1;
+                if ((index < (unsigned int)tilemap->nb_of_tiles) && (tilemap->displayed_tiles != NULL)) {
+                    index = tilemap->displayed_tiles[index];
+                }
+
+                covered = (index < (unsigned int)tilemap->nb_of_tiles) && (tilemap->tile_kinds[index] >= kTilemapTileOpaque);
+            }
+        }
+
+        if (covered) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// -- Defines a kernel drawing every tile intersecting the screen rectangle [left, right[ x [top, bottom[ with the
+// -- tilemap's origin at (x, y). If frame is not NULL, tiles are blitted straight into it instead of going through
+// -- drawBitmap(). Kernels are instantiated with constant tile sizes so divisions compile down to shifts. They walk
+// -- the map one storage chunk at a time, skipping unallocated chunks and using each chunk row's occupancy word
+// -- to jump straight from one non-empty cell to the next. Animated tiles show their current frame. Transparent
+// -- tiles and cells hidden behind the tilemap's occluders, if any, are skipped and runs of solid black or white
+// -- tiles are drawn with a single fill. Each kernel comes in two variants, for compact and wide map storage, since
+// -- only the latter can hold flipped cells.
+#define TILEMAP_DEFINE_DRAW_KERNEL(name, TILE_WIDTH, TILE_HEIGHT) \
+TILEMAP_DEFINE_CELL_KERNEL(name##Compact, TILE_WIDTH, TILE_HEIGHT, uint8_t) \
+TILEMAP_DEFINE_CELL_KERNEL(name##Wide, TILE_WIDTH, TILE_HEIGHT, uint16_t) \
+void name(Tilemap* this, uint8_t* frame, int x, int y, int left, int top, int right, int bottom) \
+{ \
+    if (this->map->compact) { \
+        name##Compact(this, frame, x, y, left, top, right, bottom); \
+    } \
+    else { \
+        name##Wide(this, frame, x, y, left, top, right, bottom); \
+    } \
+}
+
+#define TILEMAP_DEFINE_CELL_KERNEL(name, TILE_WIDTH, TILE_HEIGHT, CELL_TYPE) \
+static void name(Tilemap* this, uint8_t* frame, int x, int y, int left, int top, int right, int bottom) \
+{ \
+    int first_tile_x = tilemapFloorDiv(left - x, (TILE_WIDTH)); \
+    int first_tile_y = tilemapFloorDiv(top - y, (TILE_HEIGHT)); \
+    int last_tile_x = tilemapFloorDiv(right - 1 - x, (TILE_WIDTH)); \
+    int last_tile_y = tilemapFloorDiv(bottom - 1 - y, (TILE_HEIGHT)); \
+    if (first_tile_x < 0) { first_tile_x = 0; } \
+    if (first_tile_y < 0) { first_tile_y = 0; } \
+    if (last_tile_x >= this->width) { last_tile_x = this->width - 1; } \
+    if (last_tile_y >= this->height) { last_tile_y = this->height - 1; } \
+    if ((last_tile_x < first_tile_x) || (last_tile_y < first_tile_y)) { \
+        return; \
+    } \
+    this->nb_of_cells_in_view += (last_tile_x - first_tile_x + 1) * (last_tile_y - first_tile_y + 1); \
+    int nb_of_cells_visited = 0; \
+    const TileStorage* map = this->map; \
+    LCDBitmap** tiles = this->tiles; \
+    const uint8_t* tile_kinds = this->tile_kinds; \
+    const uint16_t* displayed_tiles = this->displayed_tiles; \
+    unsigned int nb_of_tiles = (unsigned int)this->nb_of_tiles; \
+    BlitterDrawFunction blit = this->blit; \
+    const BlitterBitmap* tile_data = this->tile_data; \
+    BlitterAtlas* atlas = this->atlas; \
+    const TilemapOccluder* occluders = this->occluders; \
+    int nb_of_occluders = this->nb_of_occluders; \
+    for (int chunk_y = first_tile_y >> TILE_STORAGE_CHUNK_SHIFT; chunk_y <= (last_tile_y >> TILE_STORAGE_CHUNK_SHIFT); ++chunk_y) { \
+        int chunk_tile_y = chunk_y << TILE_STORAGE_CHUNK_SHIFT; \
+        int first_row = (first_tile_y > chunk_tile_y) ? (first_tile_y - chunk_tile_y) : 0; \
+        int last_row = ((last_tile_y - chunk_tile_y) < TILE_STORAGE_CHUNK_MASK) ? (last_tile_y - chunk_tile_y) : TILE_STORAGE_CHUNK_MASK; \
+        for (int chunk_x = first_tile_x >> TILE_STORAGE_CHUNK_SHIFT; chunk_x <= (last_tile_x >> TILE_STORAGE_CHUNK_SHIFT); ++chunk_x) { \
+            const TileChunk* chunk = tileStorageGetChunk(map, chunk_x, chunk_y); \
+            if (chunk == NULL) { \
+                continue; \
+            } \
+            int chunk_tile_x = chunk_x << TILE_STORAGE_CHUNK_SHIFT; \
+            int first_column = (first_tile_x > chunk_tile_x) ? (first_tile_x - chunk_tile_x) : 0; \
+            int last_column = ((last_tile_x - chunk_tile_x) < TILE_STORAGE_CHUNK_MASK) ? (last_tile_x - chunk_tile_x) : TILE_STORAGE_CHUNK_MASK; \
+            uint32_t column_mask = (0xFFFFFFFFu << first_column) & (0xFFFFFFFFu >> (TILE_STORAGE_CHUNK_MASK - last_column)); \
+            for (int row = first_row; row <= last_row; ++row) { \
+                uint32_t occupied = chunk->row_occupancy[row] & column_mask; \
+                const CELL_TYPE* cells = (const CELL_TYPE*)chunk->cells + (row << TILE_STORAGE_CHUNK_SHIFT); \
+                int draw_y = y + ((chunk_tile_y + row) * (TILE_HEIGHT)); \
+                while (occupied != 0) { \
+                    int column = __builtin_ctz(occupied); \
+                    occupied &= occupied - 1; \
+                    ++nb_of_cells_visited; \
+                    /* -- Out of range indices wrap around to a huge value and are skipped. */ \
+                    unsigned int tile_index = (unsigned int)(cells[column] & TILE_STORAGE_INDEX_MASK) - 1; \
+                    if (tile_index >= nb_of_tiles) { \
+                        continue; \
+                    } \
+                    if (displayed_tiles != NULL) { \
+                        tile_index = displayed_tiles[tile_index]; \
+                    } \
+                    if (tile_kinds[tile_index] == kTilemapTileTransparent) { \
+                        TILEMAP_STATS_ADD(this, nb_of_tiles_skipped, 1); \
+                        continue; \
+                    } \
+                    int draw_x = x + ((chunk_tile_x + column) * (TILE_WIDTH)); \
+                    if ((occluders != NULL) && \
+                        tilemapIsOccluded(occluders, nb_of_occluders, draw_x, draw_y, draw_x + (TILE_WIDTH), draw_y + (TILE_HEIGHT))) { \
+                        TILEMAP_STATS_ADD(this, nb_of_tiles_culled, 1); \
+                        continue; \
+                    } \
+                    int kind = tile_kinds[tile_index]; \
+                    if (kind >= kTilemapTileBlack) { \
+                        int run_width = (TILE_WIDTH); \
+                        for (int next_column = column + 1; (next_column < TILE_STORAGE_CHUNK_SIZE) && (occupied & (1u << next_column)); ++next_column) { \
+                            unsigned int next_index = (unsigned int)(cells[next_column] & TILE_STORAGE_INDEX_MASK) - 1; \
+                            if (next_index >= nb_of_tiles) { \
+                                break; \
+                            } \
+                            if (displayed_tiles != NULL) { \
+                                next_index = displayed_tiles[next_index]; \
+                            } \
+                            if (tile_kinds[next_index] != kind) { \
+                                break; \
+                            } \
+                            if ((occluders != NULL) && \
+                                tilemapIsOccluded(occluders, nb_of_occluders, draw_x + run_width, draw_y, draw_x + run_width + (TILE_WIDTH), draw_y + (TILE_HEIGHT))) { \
+                                break; \
+                            } \
+                            occupied &= occupied - 1; \
+                            ++nb_of_cells_visited; \
+                            run_width += (TILE_WIDTH); \
+                        } \
+                        TILEMAP_STATS_ADD(this, nb_of_tiles_drawn, run_width / (TILE_WIDTH)); \
+                        if (frame != NULL) { \
+                            blitterFill(frame, draw_x, draw_y, run_width, (TILE_HEIGHT), kind == kTilemapTileWhite, left, top, right, bottom); \
+                        } \
+                        else { \
+                            pd->graphics->fillRect(draw_x, draw_y, run_width, (TILE_HEIGHT), (kind == kTilemapTileWhite) ? kColorWhite : kColorBlack); \
+                        } \
+                    } \
+                    else if (frame != NULL) { \
+                        TILEMAP_STATS_ADD(this, nb_of_tiles_drawn, 1); \
+                        LCDBitmapFlip flip = (LCDBitmapFlip)(cells[column] >> TILE_STORAGE_FLIP_SHIFT); \
+                        if (flip != kBitmapUnflipped) { \
+                            blitterDrawFlipped(frame, &tile_data[tile_index], draw_x, draw_y, flip, left, top, right, bottom); \
+                        } \
+                        else if (atlas != NULL) { \
+                            blitterAtlasDraw(atlas, frame, tile_index, draw_x, draw_y, left, top, right, bottom); \
+                        } \
+                        else { \
+                            blit(frame, &tile_data[tile_index], draw_x, draw_y, left, top, right, bottom); \
+                        } \
+                    } \
+                    else { \
+                        TILEMAP_STATS_ADD(this, nb_of_tiles_drawn, 1); \
+                        pd->graphics->drawBitmap(tiles[tile_index], draw_x, draw_y, (LCDBitmapFlip)(cells[column] >> TILE_STORAGE_FLIP_SHIFT)); \
+                    } \
+                } \
+            } \
+        } \
+    } \
+    this->nb_of_cells_visited += nb_of_cells_visited; \
+}
+
+TILEMAP_DEFINE_DRAW_KERNEL(tilemapDrawTiles8, 8, 8)
+TILEMAP_DEFINE_DRAW_KERNEL(tilemapDrawTiles16, 16, 16)
+TILEMAP_DEFINE_DRAW_KERNEL(tilemapDrawTiles32, 32, 32)
+TILEMAP_DEFINE_DRAW_KERNEL(tilemapDrawTilesGeneric, this->tile_width, this->tile_height)
+
+// -- Pick the draw kernel and blitter matching the tile size and whether any tile is transparent.
+void tilemapSelectKernels(Tilemap* this)
+{
+    this->draw_tiles = tilemapDrawTilesGeneric;
+    if (this->tile_width == this->tile_height) {
+        switch (this->tile_width) {
+            case 8:
+                this->draw_tiles = tilemapDrawTiles8;
+                break;
+            case 16:
+                this->draw_tiles = tilemapDrawTiles16;
+                break;
+            case 32:
+                this->draw_tiles = tilemapDrawTiles32;
+                break;
+            default:
+                break;
+        }
+    }
+
+    int masked = 0;
+    for (int index = 0; (this->tile_data != NULL) && (index < this->nb_of_tiles); ++index) {
+        if (this->tile_data[index].mask != NULL) {
+            masked = 1;
+            break;
+        }
+    }
+
+    this->blit = blitterGetDrawFunction(this->tile_width, this->tile_height, masked);
+}
+
+// -- Release every baked chunk and the chunk table itself.
+void tilemapFreeChunks(Tilemap* this)
+{
+    if (this->chunks != NULL) {
+        int nb_of_chunks = this->chunks_wide * this->chunks_high;
+        for (int i = 0; i < nb_of_chunks; ++i) {
+            if (this->chunks[i].bitmap != NULL) {
+                pd->graphics->freeBitmap(this->chunks[i].bitmap);
+            }
+        }
+
+        dmMemoryFree(this->chunks);
+        this->chunks = NULL;
+    }
+
+    this->chunks_wide = 0;
+    this->chunks_high = 0;
+    this->chunk_memory = 0;
+    this->most_recent_chunk = -1;
+    this->least_recent_chunk = -1;
+}
+
+// -- (Re)allocate an empty chunk table matching the current map size and chunk size.
+void tilemapSetupChunks(Tilemap* this)
+{
+    tilemapFreeChunks(this);
+
+    if ((this->chunk_size == 0) || (this->map == NULL)) {
+        return;
+    }
+
+    this->chunks_wide = (this->width + this->chunk_size - 1) / this->chunk_size;
+    this->chunks_high = (this->height + this->chunk_size - 1) / this->chunk_size;
+    this->chunks = dmMemoryCalloc(this->chunks_wide * this->chunks_high, sizeof(TilemapChunk));
+    if (this->chunks == NULL) {
+        DM_LOG("Tilemap: Error allocating chunk cache for %dx%d chunks.", this->chunks_wide, this->chunks_high);
+        this->chunks_wide = 0;
+        this->chunks_high = 0;
+    }
+}
+
+// -- Remove a baked chunk from the least-recently-used list.
+void tilemapUnlinkChunk(Tilemap* this, int chunk_index)
+{
+    TilemapChunk* chunk = &this->chunks[chunk_index];
+
+    if (chunk->previous >= 0) {
+        this->chunks[chunk->previous].next = chunk->next;
+    }
+    else {
+        this->most_recent_chunk = chunk->next;
+    }
+
+    if (chunk->next >= 0) {
+        this->chunks[chunk->next].previous = chunk->previous;
+    }
+    else {
+        this->least_recent_chunk = chunk->previous;
+    }
+}
+
+// -- Put a baked chunk at the front of the least-recently-used list.
+void tilemapLinkChunk(Tilemap* this, int chunk_index)
+{
+    TilemapChunk* chunk = &this->chunks[chunk_index];
+
+    chunk->previous = -1;
+    chunk->next = this->most_recent_chunk;
+
+    if (this->most_recent_chunk >= 0) {
+        this->chunks[this->most_recent_chunk].previous = chunk_index;
+    }
+    else {
+        this->least_recent_chunk = chunk_index;
+    }
+
+    this->most_recent_chunk = chunk_index;
+}
+
+// -- Return the memory used by a chunk bitmap, including its mask.
+int tilemapChunkMemory(LCDBitmap* bitmap)
+{
+    int width, height, rowbytes;
+    uint8_t* mask = NULL;
+    pd->graphics->getBitmapData(bitmap, &width, &height, &rowbytes, &mask, NULL);
+
+    return rowbytes * height * ((mask != NULL) ? 2 : 1);
+}
+
+// -- Free a baked chunk so it gets re-rendered next time it is drawn.
+void tilemapInvalidateChunk(Tilemap* this, int chunk_index)
+{
+    TilemapChunk* chunk = &this->chunks[chunk_index];
+    if (chunk->bitmap == NULL) {
+        return;
+    }
+
+    tilemapUnlinkChunk(this, chunk_index);
+
+    this->chunk_memory -= tilemapChunkMemory(chunk->bitmap);
+    pd->graphics->freeBitmap(chunk->bitmap);
+    chunk->bitmap = NULL;
+}
+
+// -- Return the bitmap for a chunk, rendering it first if needed and evicting older chunks to stay within budget.
+LCDBitmap* tilemapGetChunkBitmap(Tilemap* this, int chunk_x, int chunk_y)
+{
+    int chunk_index = (chunk_y * this->chunks_wide) + chunk_x;
+    TilemapChunk* chunk = &this->chunks[chunk_index];
+
+    if (chunk->bitmap != NULL) {
+        tilemapUnlinkChunk(this, chunk_index);
+        tilemapLinkChunk(this, chunk_index);
+        chunk->last_used = this->chunk_clock;
+
+        return chunk->bitmap;
+    }
+
+    // -- Chunks already drawn this frame are never evicted, the budget can be exceeded for one frame instead.
+    while ((this->least_recent_chunk >= 0) && (this->chunk_memory >= this->chunk_budget) &&
+           (this->chunks[this->least_recent_chunk].last_used != this->chunk_clock)) {
+        tilemapInvalidateChunk(this, this->least_recent_chunk);
+    }
+
+    int chunk_pixel_width = this->chunk_size * this->tile_width;
+    int chunk_pixel_height = this->chunk_size * this->tile_height;
+
+    LCDBitmap* bitmap = pd->graphics->newBitmap(chunk_pixel_width, chunk_pixel_height, kColorClear);
+    if (bitmap == NULL) {
+        DM_LOG("Tilemap: Error allocating chunk bitmap.");
+        return NULL;
+    }
+
+    int chunk_pixel_x = chunk_x * chunk_pixel_width;
+    int chunk_pixel_y = chunk_y * chunk_pixel_height;
+
+    // -- Baked chunks are reused from any position so they never take occluders into account.
+    const TilemapOccluder* occluders = this->occluders;
+    this->occluders = NULL;
+
+    pd->graphics->pushContext(bitmap);
+    pd->graphics->setDrawOffset(0, 0);
+    TILEMAP_STATS_ADD(this, nb_of_context_pushes, 1);
+    this->draw_tiles(this, NULL, -chunk_pixel_x, -chunk_pixel_y, 0, 0, chunk_pixel_width, chunk_pixel_height);
+    pd->graphics->popContext();
+
+    this->occluders = occluders;
+
+    int first_cell_x = chunk_x * this->chunk_size;
+    int first_cell_y = chunk_y * this->chunk_size;
+    int last_cell_x = ((first_cell_x + this->chunk_size) < this->width) ? (first_cell_x + this->chunk_size) : this->width;
+    int last_cell_y = ((first_cell_y + this->chunk_size) < this->height) ? (first_cell_y + this->chunk_size) : this->height;
+
+    chunk->animated = 0;
+    for (int cell_y = first_cell_y; (this->tile_animations != NULL) && !chunk->animated && (cell_y < last_cell_y); ++cell_y) {
+        for (int cell_x = first_cell_x; cell_x < last_cell_x; ++cell_x) {
+            unsigned int index = (unsigned int)(tileStorageGet(this->map, cell_x, cell_y) & TILE_STORAGE_INDEX_MASK) - 1;
+            if ((index < (unsigned int)this->nb_of_tiles) && (this->tile_animations[index] != 0)) {
+                chunk->animated = 1;
+                break;
+            }
+        }
+    }
+
+    chunk->bitmap = bitmap;
+    chunk->last_used = this->chunk_clock;
+    tilemapLinkChunk(this, chunk_index);
+
+    this->chunk_memory += tilemapChunkMemory(bitmap);
+
+    return bitmap;
+}
+
+// -- Same as the draw kernels but blits pre-rendered chunks instead of individual tiles.
+void tilemapDrawChunks(Tilemap* this, uint8_t* frame, int x, int y, int left, int top, int right, int bottom)
+{
+    int chunk_pixel_width = this->chunk_size * this->tile_width;
+    int chunk_pixel_height = this->chunk_size * this->tile_height;
+
+    int first_chunk_x = tilemapFloorDiv(left - x, chunk_pixel_width);
+    int first_chunk_y = tilemapFloorDiv(top - y, chunk_pixel_height);
+    int last_chunk_x = tilemapFloorDiv(right - 1 - x, chunk_pixel_width);
+    int last_chunk_y = tilemapFloorDiv(bottom - 1 - y, chunk_pixel_height);
+
+    if (first_chunk_x < 0) {
+        first_chunk_x = 0;
+    }
+
+    if (first_chunk_y < 0) {
+        first_chunk_y = 0;
+    }
+
+    if (last_chunk_x >= this->chunks_wide) {
+        last_chunk_x = this->chunks_wide - 1;
+    }
+
+    if (last_chunk_y >= this->chunks_high) {
+        last_chunk_y = this->chunks_high - 1;
+    }
+
+    for (int chunk_y = first_chunk_y; chunk_y <= last_chunk_y; ++chunk_y) {
+        for (int chunk_x = first_chunk_x; chunk_x <= last_chunk_x; ++chunk_x) {
+            LCDBitmap* bitmap = tilemapGetChunkBitmap(this, chunk_x, chunk_y);
+            if (bitmap == NULL) {
+                continue;
+            }
+
+            int draw_x = x + (chunk_x * chunk_pixel_width);
+            int draw_y = y + (chunk_y * chunk_pixel_height);
+
+            if (frame != NULL) {
+                BlitterBitmap chunk_data;
+                blitterGetBitmap(bitmap, &chunk_data);
+                blitterDraw(frame, &chunk_data, draw_x, draw_y, left, top, right, bottom);
+            }
+            else {
+                pd->graphics->drawBitmap(bitmap, draw_x, draw_y, kBitmapUnflipped);
+            }
+        }
+    }
+}
+
+// -- Draw the part of the tilemap inside a screen rectangle, through the chunk cache if it is enabled.
+void tilemapDrawRegion(Tilemap* this, int x, int y, int left, int top, int right, int bottom)
+{
+    uint8_t* frame = (this->direct_draw && (this->tile_data != NULL)) ? pd->graphics->getFrame() : NULL;
+
+    if (this->chunks != NULL) {
+        tilemapDrawChunks(this, frame, x, y, left, top, right, bottom);
+    }
+    else {
+        this->draw_tiles(this, frame, x, y, left, top, right, bottom);
+    }
+
+    if (frame != NULL) {
+        // -- Writing to the frame buffer directly bypasses the graphics API's own tracking of updated rows.
+        int first_row = (top < 0) ? 0 : top;
+        int last_row = (bottom > LCD_ROWS) ? LCD_ROWS - 1 : bottom - 1;
+        if (last_row >= first_row) {
+            pd->graphics->markUpdatedRows(first_row, last_row);
+        }
+    }
+}
+
+// -- Fetch the pixel data of every tile so they can be blitted directly.
+void tilemapSetupTileData(Tilemap* this)
+{
+    this->tile_data = tilesetGetTileData(this->tileset);
+}
+
+// -- Clear a screen rectangle to the background color and redraw the tiles in it.
+void tilemapRedrawRegion(Tilemap* this, int x, int y, int left, int top, int right, int bottom)
+{
+    if ((right <= left) || (bottom <= top)) {
+        return;
+    }
+
+    pd->graphics->setClipRect(left, top, right - left, bottom - top);
+    pd->graphics->fillRect(left, top, right - left, bottom - top, this->background_color);
+    tilemapDrawRegion(this, x, y, left, top, right, bottom);
+    pd->graphics->clearClipRect();
+}
+
+// -- Move the content of the frame buffer by (dx, dy) pixels. Uncovered pixels are left as they were.
+void tilemapScrollFrame(int dx, int dy)
+{
+    uint8_t* frame = pd->graphics->getFrame();
+    if (frame == NULL) {
+        return;
+    }
+
+    if (dy > 0) {
+        memmove(frame + (dy * LCD_ROWSIZE), frame, (LCD_ROWS - dy) * LCD_ROWSIZE);
+    }
+    else if (dy < 0) {
+        memmove(frame, frame - (dy * LCD_ROWSIZE), (LCD_ROWS + dy) * LCD_ROWSIZE);
+    }
+
+    if (dx == 0) {
+        return;
+    }
+
+    // -- Pixels are stored most significant bit first so moving right means shifting bytes right.
+    int nb_of_bytes = LCD_COLUMNS / 8;
+    int byte_shift = ((dx > 0) ? dx : -dx) / 8;
+    int bit_shift = ((dx > 0) ? dx : -dx) % 8;
+
+    for (int row_index = 0; row_index < LCD_ROWS; ++row_index) {
+        uint8_t* row = frame + (row_index * LCD_ROWSIZE);
+
+        if (dx > 0) {
+            for (int i = nb_of_bytes - 1; i >= 0; --i) {
+                int source = i - byte_shift;
+                uint8_t value = (source >= 0) ? (row[source] >> bit_shift) : 0;
+                if ((bit_shift != 0) && (source > 0)) {
+                    value |= (uint8_t)(row[source - 1] << (8 - bit_shift));
+                }
+
+                row[i] = value;
+            }
+        }
+        else {
+            for (int i = 0; i < nb_of_bytes; ++i) {
+                int source = i + byte_shift;
+                uint8_t value = (source < nb_of_bytes) ? (uint8_t)(row[source] << bit_shift) : 0;
+                if ((bit_shift != 0) && ((source + 1) < nb_of_bytes)) {
+                    value |= row[source + 1] >> (8 - bit_shift);
+                }
+
+                row[i] = value;
+            }
+        }
+    }
+}
+
+// -- Only redraw what changed since the last frame: the strips uncovered by scrolling and any modified tiles.
+void tilemapDrawIncremental(Tilemap* this, int x, int y)
+{
+    int display_width = pd->display->getWidth();
+    int display_height = pd->display->getHeight();
+
+    int dx = x - this->last_draw_x;
+    int dy = y - this->last_draw_y;
+
+    // -- The frame buffer can only be reused if it maps 1:1 to the display and the tilemap owned the previous frame.
+    if ((display_width != LCD_COLUMNS) || (display_height != LCD_ROWS) ||
+        (dx >= display_width) || (-dx >= display_width) || (dy >= display_height) || (-dy >= display_height) ||
+        (this->nb_of_dirty_cells > TILEMAP_MAX_DIRTY_CELLS)) {
+        this->needs_full_redraw = 1;
+    }
+
+    this->last_draw_x = x;
+    this->last_draw_y = y;
+
+    pd->graphics->pushContext(NULL);
+    pd->graphics->setDrawOffset(0, 0);
+    TILEMAP_STATS_ADD(this, nb_of_context_pushes, 1);
+
+    if (this->needs_full_redraw) {
+        tilemapRedrawRegion(this, x, y, 0, 0, display_width, display_height);
+        pd->graphics->markUpdatedRows(0, display_height - 1);
+
+        this->needs_full_redraw = 0;
+        this->nb_of_dirty_cells = 0;
+
+        pd->graphics->popContext();
+        return;
+    }
+
+    int first_updated_row = display_height;
+    int last_updated_row = -1;
+
+    if ((dx != 0) || (dy != 0)) {
+        tilemapScrollFrame(dx, dy);
+
+        // -- Vertical strip uncovered by the horizontal scroll.
+        if (dx > 0) {
+            tilemapRedrawRegion(this, x, y, 0, 0, dx, display_height);
+        }
+        else if (dx < 0) {
+            tilemapRedrawRegion(this, x, y, display_width + dx, 0, display_width, display_height);
+        }
+
+        // -- Horizontal strip uncovered by the vertical scroll.
+        if (dy > 0) {
+            tilemapRedrawRegion(this, x, y, 0, 0, display_width, dy);
+        }
+        else if (dy < 0) {
+            tilemapRedrawRegion(this, x, y, 0, display_height + dy, display_width, display_height);
+        }
+
+        first_updated_row = 0;
+        last_updated_row = display_height - 1;
+    }
+
+    for (int i = 0; i < this->nb_of_dirty_cells; ++i) {
+        int cell = this->dirty_cells[i];
+        int left = x + ((cell % this->width) * this->tile_width);
+        int top = y + ((cell / this->width) * this->tile_height);
+        int right = left + this->tile_width;
+        int bottom = top + this->tile_height;
+
+        if ((right <= 0) || (bottom <= 0) || (left >= display_width) || (top >= display_height)) {
+            continue;
+        }
+
+        tilemapRedrawRegion(this, x, y, left, top, right, bottom);
+
+        if (top < first_updated_row) {
+            first_updated_row = (top < 0) ? 0 : top;
+        }
+
+        if (bottom > last_updated_row) {
+            last_updated_row = (bottom > display_height) ? display_height - 1 : bottom - 1;
+        }
+    }
+
+    this->nb_of_dirty_cells = 0;
+
+    if (last_updated_row >= first_updated_row) {
+        pd->graphics->markUpdatedRows(first_updated_row, last_updated_row);
+    }
+
+    pd->graphics->popContext();
+}
+
+// -- Add cell (x, y), 0-based, to the cells redrawn by the next incremental draw.
+void tilemapAddDirtyCell(Tilemap* this, int x, int y)
+{
+    if (this->nb_of_dirty_cells < TILEMAP_MAX_DIRTY_CELLS) {
+        this->dirty_cells[this->nb_of_dirty_cells] = (y * this->width) + x;
+    }
+
+    // -- Once the list overflows the count is still incremented so the next draw falls back to a full redraw.
+    if (this->nb_of_dirty_cells <= TILEMAP_MAX_DIRTY_CELLS) {
+        ++this->nb_of_dirty_cells;
+    }
+}
+
+// -- Free every baked chunk containing animated tiles, or all of them if all is set.
+void tilemapInvalidateAnimatedChunks(Tilemap* this, int all)
+{
+    int chunk_index = this->most_recent_chunk;
+    while (chunk_index >= 0) {
+        int next = this->chunks[chunk_index].next;
+        if (all || this->chunks[chunk_index].animated) {
+            tilemapInvalidateChunk(this, chunk_index);
+        }
+
+        chunk_index = next;
+    }
+}
+
+// -- Advance animations to the current time. Cells showing an animation whose frame changed are invalidated in the
+// -- chunk cache and, when drawing incrementally, marked dirty if they are in view with the tilemap at (x, y).
+void tilemapUpdateAnimations(Tilemap* this, int x, int y)
+{
+    if (this->nb_of_animations == 0) {
+        return;
+    }
+
+    unsigned int now = pd->system->getCurrentTimeMilliseconds();
+
+    uint8_t changed[TILEMAP_MAX_ANIMATIONS];
+    int has_changed = 0;
+
+    for (int i = 0; i < this->nb_of_animations; ++i) {
+        TilemapAnimation* animation = &this->animations[i];
+        int frame = (int)((now / (unsigned int)animation->frame_duration) % (unsigned int)animation->nb_of_frames);
+
+        changed[i] = (frame != animation->current_frame);
+        if (changed[i]) {
+            animation->current_frame = frame;
+            this->displayed_tiles[animation->base_index - 1] = (uint16_t)(animation->base_index - 1 + frame);
+            has_changed = 1;
+        }
+    }
+
+    if (!has_changed) {
+        return;
+    }
+
+    if (this->chunks != NULL) {
+        tilemapInvalidateAnimatedChunks(this, 0);
+    }
+
+    if (!this->incremental_draw || this->needs_full_redraw || (this->map == NULL)) {
+        return;
+    }
+
+    int first_tile_x = tilemapFloorDiv(-x, this->tile_width);
+    int first_tile_y = tilemapFloorDiv(-y, this->tile_height);
+    int last_tile_x = tilemapFloorDiv(pd->display->getWidth() - 1 - x, this->tile_width);
+    int last_tile_y = tilemapFloorDiv(pd->display->getHeight() - 1 - y, this->tile_height);
+
+    first_tile_x = (first_tile_x < 0) ? 0 : first_tile_x;
+    first_tile_y = (first_tile_y < 0) ? 0 : first_tile_y;
+    last_tile_x = (last_tile_x >= this->width) ? this->width - 1 : last_tile_x;
+    last_tile_y = (last_tile_y >= this->height) ? this->height - 1 : last_tile_y;
+
+    for (int tile_y = first_tile_y; (tile_y <= last_tile_y) && (this->nb_of_dirty_cells <= TILEMAP_MAX_DIRTY_CELLS); ++tile_y) {
+        for (int tile_x = first_tile_x; tile_x <= last_tile_x; ++tile_x) {
+            unsigned int index = (unsigned int)(tileStorageGet(this->map, tile_x, tile_y) & TILE_STORAGE_INDEX_MASK) - 1;
+            if ((index < (unsigned int)this->nb_of_tiles) && (this->tile_animations[index] != 0) &&
+                changed[this->tile_animations[index] - 1]) {
+                tilemapAddDirtyCell(this, tile_x, tile_y);
+            }
+        }
+    }
+}
+
+// -- Draw cell (x, y), 0-based, set to value into the overview's pixel data as a block of overview_scale pixels
+// -- dithered to the coverage of its tile.
+static void tilemapDrawOverviewCell(Tilemap* this, uint8_t* data, int rowbytes, int x, int y, uint16_t value)
+{
+    unsigned int index = (unsigned int)(value & TILE_STORAGE_INDEX_MASK) - 1;
+    int coverage = (index < (unsigned int)this->nb_of_tiles) ? this->tile_coverages[index] : 0;
+    int scale = this->overview_scale;
+
+    for (int pixel_y = y * scale; pixel_y < ((y + 1) * scale); ++pixel_y) {
+        uint8_t* row = data + (pixel_y * rowbytes);
+        const uint8_t* thresholds = tilesetDitherThresholds[pixel_y & 3];
+
+        for (int pixel_x = x * scale; pixel_x < ((x + 1) * scale); ++pixel_x) {
+            uint8_t bit = (uint8_t)(0x80 >> (pixel_x & 7));
+            if (coverage > thresholds[pixel_x & 3]) {
+                row[pixel_x >> 3] &= (uint8_t)~bit;
+            }
+            else {
+                row[pixel_x >> 3] |= bit;
+            }
+        }
+    }
+}
+
+// -- Draw the non-empty cells of rows first_row to last_row - 1 into the overview, which must be white there.
+static void tilemapDrawOverviewRows(Tilemap* this, int first_row, int last_row)
+{
+    int rowbytes;
+    uint8_t* data = NULL;
+    pd->graphics->getBitmapData(this->overview, NULL, NULL, &rowbytes, NULL, &data);
+
+    const TileStorage* map = this->map;
+    for (int y = first_row; y < last_row; ++y) {
+        for (int chunk_x = 0; chunk_x < map->chunks_wide; ++chunk_x) {
+            const TileChunk* chunk = tileStorageGetChunk(map, chunk_x, y >> TILE_STORAGE_CHUNK_SHIFT);
+            if (chunk == NULL) {
+                continue;
+            }
+
+            int row_index = (y & TILE_STORAGE_CHUNK_MASK) << TILE_STORAGE_CHUNK_SHIFT;
+            uint32_t occupied = chunk->row_occupancy[y & TILE_STORAGE_CHUNK_MASK];
+            while (occupied != 0) {
+                int column = __builtin_ctz(occupied);
+                occupied &= occupied - 1;
+
+                tilemapDrawOverviewCell(this, data, rowbytes, (chunk_x << TILE_STORAGE_CHUNK_SHIFT) + column, y,
+                                        tileStorageGetChunkCell(map, chunk, row_index + column));
+            }
+        }
+    }
+}
+
+// -- Free the overview, it is built again the next time it is asked for.
+static void tilemapFreeOverview(Tilemap* this)
+{
+    if (this->overview != NULL) {
+        pd->graphics->freeBitmap(this->overview);
+        this->overview = NULL;
+    }
+}
+
+// -- Return the overview at scale, building it from the whole map if it doesn't exist at that scale yet. Returns
+// -- NULL on error.
+static LCDBitmap* tilemapGetOverview(Tilemap* this, int scale)
+{
+    if ((this->overview != NULL) && (this->overview_scale == scale)) {
+        return this->overview;
+    }
+
+    tilemapFreeOverview(this);
+
+    if (this->tile_coverages == NULL) {
+        this->tile_coverages = tilesetGetTileCoverages(this->tileset);
+        if (this->tile_coverages == NULL) {
+            return NULL;
+        }
+    }
+
+    int width = this->width * scale;
+    int height = this->height * scale;
+    if ((width > TILEMAP_MAX_OVERVIEW_SIZE) || (height > TILEMAP_MAX_OVERVIEW_SIZE)) {
+        DM_LOG("Tilemap: Overview of %dx%d pixels is too big.", width, height);
+        return NULL;
+    }
+
+    this->overview = pd->graphics->newBitmap(width, height, kColorWhite);
+    if (this->overview == NULL) {
+        DM_LOG("Tilemap: Error allocating an overview of %dx%d pixels.", width, height);
+        return NULL;
+    }
+
+    this->overview_scale = scale;
+    tilemapDrawOverviewRows(this, 0, this->height);
+
+    return this->overview;
+}
+
+// -- Set the value of cell (x, y), 0-based, and invalidate anything drawn from it.
+// -- Returns 1 if the cell changed, 0 otherwise.
+int tilemapSetCell(Tilemap* this, int x, int y, uint16_t value)
+{
+    if (tileStorageGet(this->map, x, y) == value) {
+        return 0;
+    }
+
+    if (!tileStorageSet(this->map, x, y, value)) {
+        return 0;
+    }
+
+    if (this->chunks != NULL) {
+        int chunk_x = x / this->chunk_size;
+        int chunk_y = y / this->chunk_size;
+        tilemapInvalidateChunk(this, (chunk_y * this->chunks_wide) + chunk_x);
+    }
+
+    if (this->collision != NULL) {
+        collisionUpdateCell(this->collision, x, y);
+    }
+
+    if (this->overview != NULL) {
+        int rowbytes;
+        uint8_t* data = NULL;
+        pd->graphics->getBitmapData(this->overview, NULL, NULL, &rowbytes, NULL, &data);
+        tilemapDrawOverviewCell(this, data, rowbytes, x, y, value);
+    }
+
+    tilemapAddDirtyCell(this, x, y);
+
+    return 1;
+}
+
+// -- Clip a rectangle of cells, 0-based, to the map. Returns 0 if nothing is left.
+int tilemapClipRect(Tilemap* this, int* x, int* y, int* width, int* height)
+{
+    if (*x < 0) {
+        *width += *x;
+        *x = 0;
+    }
+
+    if (*y < 0) {
+        *height += *y;
+        *y = 0;
+    }
+
+    if (*width > (this->width - *x)) {
+        *width = this->width - *x;
+    }
+
+    if (*height > (this->height - *y)) {
+        *height = this->height - *y;
+    }
+
+    return (*width > 0) && (*height > 0);
+}
+
+// -- Stop loading a map file, leaving the rows read so far in the map.
+static void tilemapStopLoading(Tilemap* this)
+{
+    if (this->loader != NULL) {
+        mapFileClose(this->loader);
+        this->loader = NULL;
+    }
+}
+
+// -- Called when the tilemap's arena is reset. Everything allocated in it is gone so the tilemap goes back to having
+// -- no size set.
+static void tilemapArenaReset(void* owner)
+{
+    Tilemap* this = owner;
+
+    tilemapStopLoading(this);
+
+    this->map = NULL;
+    this->collision = NULL;
+    this->pathfinding = NULL;
+    this->autotile = NULL;
+
+    this->width = 0;
+    this->height = 0;
+
+    tilemapSetupChunks(this);
+    tilemapFreeOverview(this);
+
+    this->needs_full_redraw = 1;
+    this->nb_of_dirty_cells = 0;
+}
+
+// -- Allocate a new tilemap. If arena, a dm.TilemapArena, is specified the map, collision and path finding data
+// -- are allocated in it.
+// function Tilemap.new(path, arena)
+int tilemapNew(lua_State* L)
+{
+    Tilemap* this = dmMemoryCalloc(1, sizeof(Tilemap));
+    if (this == NULL) {
+        return 0;
+    }
+
+    const char* path = pd->lua->getArgString(1);
+    if (path == NULL) {
+        DM_LOG("Tilemap: Error getting tilemap path argument.");
+        return 0;
+    }
+
+    this->arena = NULL;
+    this->arena_object = NULL;
+
+    if (!pd->lua->argIsNil(2)) {
+        LuaUDObject* object = NULL;
+        this->arena = pd->lua->getArgObject(2, CLASSNAME_TILEMAPARENA, &object);
+        if ((this->arena == NULL) || !arenaAddUser(this->arena, this, tilemapArenaReset)) {
+            DM_LOG("Tilemap: Error getting 'arena' argument.");
+            dmMemoryFree(this);
+            return 0;
+        }
+
+        this->arena_object = pd->lua->retainObject(object);
+    }
+
+    this->tileset = tilesetAcquire(path);
+    if (this->tileset == NULL) {
+        if (this->arena != NULL) {
+            arenaRemoveUser(this->arena, this);
+            pd->lua->releaseObject(this->arena_object);
+        }
+
+        dmMemoryFree(this);
+        return 0;
+    }
+    
+    this->height = 0;
+    this->width = 0;
+
+    this->tile_width = this->tileset->tile_width;
+    this->tile_height = this->tileset->tile_height;
+
+    this->nb_of_tiles = this->tileset->nb_of_tiles;
+    this->tiles = this->tileset->tiles;
+    this->tile_kinds = this->tileset->tile_kinds;
+
+    this->map = NULL;
+    this->loader = NULL;
+    this->collision = NULL;
+    this->pathfinding = NULL;
+    this->autotile = NULL;
+
+    this->chunk_size = 0;
+    this->chunks = NULL;
+    this->most_recent_chunk = -1;
+    this->least_recent_chunk = -1;
+
+    this->direct_draw = 0;
+    this->tile_data = NULL;
+    this->atlas = NULL;
+
+    this->incremental_draw = 0;
+    this->needs_full_redraw = 1;
+    this->background_color = kColorWhite;
+    this->nb_of_dirty_cells = 0;
+
+    this->nb_of_animations = 0;
+    this->displayed_tiles = NULL;
+    this->tile_animations = NULL;
+
+    this->occluders = NULL;
+    this->nb_of_occluders = 0;
+
+    this->overview = NULL;
+    this->overview_scale = 0;
+    this->tile_coverages = NULL;
+
+    tilemapSelectKernels(this);
+
+    pd->lua->pushObject(this, CLASSNAME_TILEMAP, 0);
+
+    return 1;
+}
+ 
+// -- Delete the tilemap
+int tilemapDelete(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+    
+    tilemapFreeChunks(this);
+    tilemapFreeOverview(this);
+
+    if (this->atlas != NULL) {
+        blitterAtlasDelete(this->atlas);
+        this->atlas = NULL;
+    }
+
+    if (this->displayed_tiles != NULL) {
+        dmMemoryFree(this->displayed_tiles);
+        this->displayed_tiles = NULL;
+    }
+
+    if (this->tile_animations != NULL) {
+        dmMemoryFree(this->tile_animations);
+        this->tile_animations = NULL;
+    }
+
+    if (this->tileset != NULL) {
+        tilesetRelease(this->tileset);
+        this->tileset = NULL;
+    }
+    
+    if (this->collision != NULL) {
+        collisionDelete(this->collision);
+        this->collision = NULL;
+    }
+
+    if (this->pathfinding != NULL) {
+        pathfindingDelete(this->pathfinding);
+        this->pathfinding = NULL;
+    }
+
+    if (this->autotile != NULL) {
+        autotileDelete(this->autotile);
+        this->autotile = NULL;
+    }
+
+    tilemapStopLoading(this);
+
+    if (this->map != NULL) {
+        tileStorageDelete(this->map);
+        this->map = NULL;
+    }
+
+    if (this->arena != NULL) {
+        arenaRemoveUser(this->arena, this);
+        pd->lua->releaseObject(this->arena_object);
+        this->arena = NULL;
+    }
+    
+    dmMemoryFree(this);
+    
+    return 0;
+}
+
+// -- Draws the tile map at screen coordinate (x, y).
+// -- If the source rectangle (sourceX, sourceY, sourceWidth, sourceHeight), in pixels relative to the tilemap's origin,
+// -- is specified only the tiles intersecting it are visited and only the part of the tilemap within it is drawn.
+// -- The Lua draw(x, y, sourceRect) takes it as a playdate.geometry.rect.
+// function Tilemap:draw(x, y, sourceX, sourceY, sourceWidth, sourceHeight)
+int tilemapDraw(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+    
+    if (this->map == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before draw().");
+        return 0;
+    }
+    
+    int x = pd->lua->getArgInt(2);
+    int y = pd->lua->getArgInt(3);
+
+    int left = 0;
+    int top = 0;
+    int right = pd->display->getWidth();
+    int bottom = pd->display->getHeight();
+
+    int clipped = !pd->lua->argIsNil(4);
+    if (clipped) {
+        int source_left = x + pd->lua->getArgInt(4);
+        int source_top = y + pd->lua->getArgInt(5);
+        int source_right = source_left + pd->lua->getArgInt(6);
+        int source_bottom = source_top + pd->lua->getArgInt(7);
+
+        left = (source_left > left) ? source_left : left;
+        top = (source_top > top) ? source_top : top;
+        right = (source_right < right) ? source_right : right;
+        bottom = (source_bottom < bottom) ? source_bottom : bottom;
+
+        if ((right <= left) || (bottom <= top)) {
+            return 0;
+        }
+    }
+
+    ++this->chunk_clock;
+
+    this->nb_of_cells_in_view = 0;
+    this->nb_of_cells_visited = 0;
+
+    tilemapStatsBeginDraw(this);
+
+    tilemapUpdateAnimations(this, x, y);
+
+    if (this->incremental_draw && !clipped) {
+        tilemapDrawIncremental(this, x, y);
+    }
+    else {
+        pd->graphics->pushContext(NULL);
+        pd->graphics->setDrawOffset(0, 0);
+        TILEMAP_STATS_ADD(this, nb_of_context_pushes, 1);
+
+        if (!clipped) {
+            tilemapDrawRegion(this, x, y, left, top, right, bottom);
+        }
+        else if (this->incremental_draw) {
+            // -- The background is cleared as usual but the rest of the frame buffer can't be reused next time.
+            tilemapRedrawRegion(this, x, y, left, top, right, bottom);
+            this->needs_full_redraw = 1;
+        }
+        else {
+            // -- Tiles on the edges are only partly inside. The blitter clips them itself, the graphics API needs this.
+            pd->graphics->setClipRect(left, top, right - left, bottom - top);
+            tilemapDrawRegion(this, x, y, left, top, right, bottom);
+            pd->graphics->clearClipRect();
+        }
+
+        pd->graphics->popContext();
+    }
+
+    tilemapStatsEndDraw(this);
+
+    return 0;
+}
+
+// -- Convert a zoom factor passed from Lua to the scale of tiles drawn with it. Returns 0 if there isn't one.
+static int tilemapGetTilesetScale(float factor, TilesetScale* scale)
+{
+    if (factor == 2.0f) {
+        *scale = kTilesetScaleDouble;
+    }
+    else if (factor == 0.5f) {
+        *scale = kTilesetScaleHalf;
+    }
+    else if (factor == 0.25f) {
+        *scale = kTilesetScaleQuarter;
+    }
+    else {
+        return 0;
+    }
+
+    return 1;
+}
+
+// -- Draws the tile map at screen coordinate (x, y) zoomed by scale, which can be 2, 0.5 or 0.25. Scaled copies of
+// -- the tiles are made the first time a scale is used and kept until releaseScaledTiles(). Only the tiles in view are
+// -- visited, as with draw(), but the chunk cache and tile atlas are not used.
+// function Tilemap:drawScaled(x, y, scale)
+int tilemapDrawScaled(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    if (this->map == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before drawScaled().");
+        return 0;
+    }
+
+    int x = pd->lua->getArgInt(2);
+    int y = pd->lua->getArgInt(3);
+
+    TilesetScale scale;
+    float factor = pd->lua->getArgFloat(4);
+    if (!tilemapGetTilesetScale(factor, &scale)) {
+        DM_LOG("Tilemap: Invalid scale %f for drawScaled(), only 2, 0.5 and 0.25 are supported.", (double)factor);
+        return 0;
+    }
+
+    TilesetScaledTiles* scaled_tiles = tilesetGetScaledTiles(this->tileset, scale);
+    if (scaled_tiles == NULL) {
+        return 0;
+    }
+
+    // -- The draw kernels work on the tilemap's own tiles so the scaled ones stand in for them during this draw.
+    int tile_width = this->tile_width;
+    int tile_height = this->tile_height;
+    LCDBitmap** tiles = this->tiles;
+    uint8_t* tile_kinds = this->tile_kinds;
+    BlitterBitmap* tile_data = this->tile_data;
+    BlitterAtlas* atlas = this->atlas;
+    TilemapDrawKernel draw_tiles = this->draw_tiles;
+    BlitterDrawFunction blit = this->blit;
+
+    this->tile_width = scaled_tiles->tile_width;
+    this->tile_height = scaled_tiles->tile_height;
+    this->tiles = scaled_tiles->tiles;
+    this->tile_kinds = scaled_tiles->tile_kinds;
+    this->tile_data = (tile_data != NULL) ? scaled_tiles->tile_data : NULL;
+    this->atlas = NULL;
+    tilemapSelectKernels(this);
+
+    this->nb_of_cells_in_view = 0;
+    this->nb_of_cells_visited = 0;
+
+    tilemapStatsBeginDraw(this);
+
+    tilemapUpdateAnimations(this, x, y);
+
+    pd->graphics->pushContext(NULL);
+    pd->graphics->setDrawOffset(0, 0);
+    TILEMAP_STATS_ADD(this, nb_of_context_pushes, 1);
+
+    int width = pd->display->getWidth();
+    int height = pd->display->getHeight();
+    uint8_t* frame = (this->direct_draw && (this->tile_data != NULL)) ? pd->graphics->getFrame() : NULL;
+
+    this->draw_tiles(this, frame, x, y, 0, 0, width, height);
+
+    if (frame != NULL) {
+        pd->graphics->markUpdatedRows(0, height - 1);
+    }
+
+    pd->graphics->popContext();
+
+    tilemapStatsEndDraw(this);
+
+    this->tile_width = tile_width;
+    this->tile_height = tile_height;
+    this->tiles = tiles;
+    this->tile_kinds = tile_kinds;
+    this->tile_data = tile_data;
+    this->atlas = atlas;
+    this->draw_tiles = draw_tiles;
+    this->blit = blit;
+
+    // -- Whatever incremental drawing left in the frame buffer was just drawn over.
+    this->needs_full_redraw = 1;
+
+    return 0;
+}
+
+// -- Frees the scaled copies of the tiles made by drawScaled() for scale, or for every scale if scale is nil. They
+// -- are shared with every tilemap using the same image table and are made again the next time they are needed.
+// function Tilemap:releaseScaledTiles(scale)
+int tilemapReleaseScaledTiles(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    if (pd->lua->argIsNil(2)) {
+        for (int scale = 0; scale < kTilesetNbOfScales; ++scale) {
+            tilesetReleaseScaledTiles(this->tileset, (TilesetScale)scale);
+        }
+
+        return 0;
+    }
+
+    TilesetScale scale;
+    float factor = pd->lua->getArgFloat(2);
+    if (!tilemapGetTilesetScale(factor, &scale)) {
+        DM_LOG("Tilemap: Invalid scale %f for releaseScaledTiles().", (double)factor);
+        return 0;
+    }
+
+    tilesetReleaseScaledTiles(this->tileset, scale);
+
+    return 0;
+}
+
+// -- Sets the index of the tile at tilemap position (x, y). index is the (1-based) index of the image
+// -- in the tilemap’s playdate.graphics.imagetable. flip (defaults to playdate.graphics.kImageUnflipped)
+// -- flips the image when it is drawn.
+// function Tilemap:setTileAtPosition(x, y, index, flip)
+int tilemapSetTileAtPosition(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+    
+    if (this->map == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before setTileAtPosition().");
+        return 0;
+    }
+    
+    int x = pd->lua->getArgInt(2);
+    int y = pd->lua->getArgInt(3);
+    
+    if ((x < 1) || (x > this->width) || (y < 1) || (y > this->height)) {
+        DM_LOG("Tilemap: Out of bounds values %d,%s for getTileAtPosition.", x, y);
+        return 0;
+    }
+
+    int tilemap_index = pd->lua->getArgInt(4);
+    if ((tilemap_index < 0) || (tilemap_index > TILE_STORAGE_INDEX_MASK)) {
+        DM_LOG("Tilemap: Out of bounds tile index %d for getTileAtPosition.", tilemap_index);
+        return 0;
+    }
+
+    int flip = pd->lua->argIsNil(5) ? kBitmapUnflipped : pd->lua->getArgInt(5);
+    if ((flip < kBitmapUnflipped) || (flip > kBitmapFlippedXY)) {
+        DM_LOG("Tilemap: Invalid flip %d for setTileAtPosition.", flip);
+        return 0;
+    }
+
+    tilemapSetCell(this, x - 1, y - 1, (tilemap_index != 0) ? (uint16_t)(tilemap_index | (flip << TILE_STORAGE_FLIP_SHIFT)) : 0);
+
+    return 0;
+}
+
+// -- Returns the image index of the tile at the given x and y coordinate and how it is flipped, as multiple values
+// -- (index, flip). If x or y is out of bounds, returns nil.
+// function Tilemap:getTileAtPosition(x, y)
+int tilemapGetTileAtPosition(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    if (this->map == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before getTileAtPosition().");
+        return 0;
+    }
+
+    int x = pd->lua->getArgInt(2);
+    int y = pd->lua->getArgInt(3);
+
+    if ((x < 1) || (x > this->width) || (y < 1) || (y > this->height)) {
+        DM_LOG("Tilemap: Out of bounds values %d,%s for getTileAtPosition.", x, y);
+        return 0;
+    }
+
+    uint16_t value = tileStorageGet(this->map, x - 1, y - 1);
+    pd->lua->pushInt(value & TILE_STORAGE_INDEX_MASK);
+    pd->lua->pushInt(value >> TILE_STORAGE_FLIP_SHIFT);
+
+    return 2;
+}
+
+// -- Reset everything derived from the map after it was replaced or resized.
+void tilemapMapChanged(Tilemap* this)
+{
+    if ((this->collision != NULL) && !collisionSetMap(this->collision, this->map)) {
+        collisionDelete(this->collision);
+        this->collision = NULL;
+    }
+
+    if ((this->pathfinding != NULL) && !pathfindingSetMap(this->pathfinding, this->map)) {
+        pathfindingDelete(this->pathfinding);
+        this->pathfinding = NULL;
+    }
+
+    if (this->autotile != NULL) {
+        autotileSetMap(this->autotile, this->map);
+    }
+
+    tilemapSetupChunks(this);
+    tilemapSelectKernels(this);
+    tilemapFreeOverview(this);
+
+    this->needs_full_redraw = 1;
+    this->nb_of_dirty_cells = 0;
+}
+
+// -- Sets the tilemap's width to width, then populates the tilemap with data, a string of little endian 16 bit
+// -- tile indices (as made by string.pack('<I2I2...', ...)) whose length sets the tilemap's height. The top two bits
+// -- of each index can hold a playdate.graphics flip value, i.e. index | (flip << 14).
+// function Tilemap:setTilesFromBytes(data, width)
+int tilemapSetTilesFromBytes(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    size_t length = 0;
+    const uint8_t* data = (const uint8_t*)pd->lua->getArgBytes(2, &length);
+    int width = pd->lua->getArgInt(3);
+
+    if ((data == NULL) || (width <= 0) || (width > TILEMAP_MAX_SIZE)) {
+        DM_LOG("Tilemap: Invalid arguments for setTilesFromBytes().");
+        return 0;
+    }
+
+    int height = (int)(length / 2) / width;
+    if ((height <= 0) || (height > TILEMAP_MAX_SIZE) || ((size_t)(width * height * 2) != length)) {
+        DM_LOG("Tilemap: Data size %d does not match a width of %d for setTilesFromBytes().", (int)length, width);
+        return 0;
+    }
+
+    TileStorage* map = tileStorageNew(width, height, this->arena);
+    if (map == NULL) {
+        DM_LOG("Tilemap: Error allocating a map of %dx%d tiles.", width, height);
+        return 0;
+    }
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint16_t value = (uint16_t)(data[0] | (data[1] << 8));
+            if ((value != 0) && !tileStorageSet(map, x, y, value)) {
+                tileStorageDelete(map);
+                return 0;
+            }
+
+            data += 2;
+        }
+    }
+
+    tilemapStopLoading(this);
+
+    if (this->map != NULL) {
+        tileStorageDelete(this->map);
+    }
+
+    this->map = map;
+    this->width = width;
+    this->height = height;
+
+    tilemapMapChanged(this);
+
+    return 0;
+}
+
+// -- Returns the content of the rectangle of tiles at (x, y) of size width x height as a string of little
+// -- endian 16 bit tile indices, row by row. The rectangle must be inside the tilemap.
+// function Tilemap:getTilesInRect(x, y, width, height)
+int tilemapGetTilesInRect(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    if (this->map == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before getTilesInRect().");
+        return 0;
+    }
+
+    int x = pd->lua->getArgInt(2) - 1;
+    int y = pd->lua->getArgInt(3) - 1;
+    int width = pd->lua->getArgInt(4);
+    int height = pd->lua->getArgInt(5);
+
+    // -- Compared as distances to the edges so that a huge width or height can't overflow x + width.
+    if ((x < 0) || (y < 0) || (width <= 0) || (height <= 0) || (width > (this->width - x)) || (height > (this->height - y))) {
+        DM_LOG("Tilemap: Out of bounds rect %d,%d %dx%d for getTilesInRect().", x + 1, y + 1, width, height);
+        return 0;
+    }
+
+    uint8_t* data = dmMemoryCalloc(width * height, 2);
+    if (data == NULL) {
+        DM_LOG("Tilemap: Error allocating %d bytes for getTilesInRect().", width * height * 2);
+        return 0;
+    }
+
+    uint8_t* current = data;
+    for (int row = y; row < (y + height); ++row) {
+        for (int column = x; column < (x + width); ++column) {
+            uint16_t value = tileStorageGet(this->map, column, row);
+            current[0] = (uint8_t)value;
+            current[1] = (uint8_t)(value >> 8);
+            current += 2;
+        }
+    }
+
+    pd->lua->pushBytes((const char*)data, width * height * 2);
+
+    dmMemoryFree(data);
+
+    return 1;
+}
+
+// -- Sets the rectangle of tiles at (x, y) of size width x height from a string of little endian 16 bit tile
+// -- indices, row by row. Parts of the rectangle outside of the tilemap are ignored.
+// function Tilemap:setTilesInRect(x, y, width, height, data)
+int tilemapSetTilesInRect(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    if (this->map == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before setTilesInRect().");
+        return 0;
+    }
+
+    int x = pd->lua->getArgInt(2) - 1;
+    int y = pd->lua->getArgInt(3) - 1;
+    int width = pd->lua->getArgInt(4);
+    int height = pd->lua->getArgInt(5);
+
+    size_t length = 0;
+    const uint8_t* data = (const uint8_t*)pd->lua->getArgBytes(6, &length);
+    // -- width * height * 2 can overflow an int, so length is divided by the size of a row instead.
+    size_t row_length = (size_t)width * 2;
+    if ((data == NULL) || (width <= 0) || (height <= 0) || ((length % row_length) != 0) || ((length / row_length) != (size_t)height)) {
+        DM_LOG("Tilemap: Invalid arguments for setTilesInRect().");
+        return 0;
+    }
+
+    int data_width = width;
+    int clipped_x = x;
+    int clipped_y = y;
+    if (!tilemapClipRect(this, &clipped_x, &clipped_y, &width, &height)) {
+        return 0;
+    }
+
+    for (int row = 0; row < height; ++row) {
+        const uint8_t* current = data + ((((clipped_y - y) + row) * data_width) + (clipped_x - x)) * 2;
+        for (int column = 0; column < width; ++column) {
+            tilemapSetCell(this, clipped_x + column, clipped_y + row, (uint16_t)(current[0] | (current[1] << 8)));
+            current += 2;
+        }
+    }
+
+    return 0;
+}
+
+// -- Sets all the tiles in the rectangle at (x, y) of size width x height to index. Parts of the rectangle
+// -- outside of the tilemap are ignored.
+// function Tilemap:fillRect(x, y, width, height, index)
+int tilemapFillRect(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    if (this->map == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before fillRect().");
+        return 0;
+    }
+
+    int x = pd->lua->getArgInt(2) - 1;
+    int y = pd->lua->getArgInt(3) - 1;
+    int width = pd->lua->getArgInt(4);
+    int height = pd->lua->getArgInt(5);
+
+    int tilemap_index = pd->lua->getArgInt(6);
+    if ((tilemap_index < 0) || (tilemap_index > TILE_STORAGE_INDEX_MASK)) {
+        DM_LOG("Tilemap: Out of bounds tile index %d for fillRect().", tilemap_index);
+        return 0;
+    }
+
+    if (!tilemapClipRect(this, &x, &y, &width, &height)) {
+        return 0;
+    }
+
+    for (int row = y; row < (y + height); ++row) {
+        for (int column = x; column < (x + width); ++column) {
+            tilemapSetCell(this, column, row, tilemap_index);
+        }
+    }
+
+    return 0;
+}
+
+// -- Copies the rectangle of tiles at (sourceX, sourceY) of size width x height in source, another dm.Tilemap or
+// -- this one, to (x, y) in this tilemap. Overlapping rectangles are handled and parts of either rectangle
+// -- outside of their tilemap are ignored.
+// function Tilemap:copyRect(source, sourceX, sourceY, width, height, x, y)
+int tilemapCopyRect(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    Tilemap* source = GET_TILEMAP_ARG(2);
+    if(source == NULL) {
+        DM_LOG("Tilemap: Error getting 'source' argument.");
+        return 0;
+    }
+
+    if ((this->map == NULL) || (source->map == NULL)) {
+        DM_LOG("Tilemap: Size of tilemap not set before copyRect().");
+        return 0;
+    }
+
+    int source_x = pd->lua->getArgInt(3) - 1;
+    int source_y = pd->lua->getArgInt(4) - 1;
+    int width = pd->lua->getArgInt(5);
+    int height = pd->lua->getArgInt(6);
+    int x = pd->lua->getArgInt(7) - 1;
+    int y = pd->lua->getArgInt(8) - 1;
+
+    // -- Clip against the source first, then move the result over to the destination and clip again.
+    int clipped_x = source_x;
+    int clipped_y = source_y;
+    if (!tilemapClipRect(source, &clipped_x, &clipped_y, &width, &height)) {
+        return 0;
+    }
+
+    x += clipped_x - source_x;
+    y += clipped_y - source_y;
+    source_x = clipped_x;
+    source_y = clipped_y;
+
+    clipped_x = x;
+    clipped_y = y;
+    if (!tilemapClipRect(this, &clipped_x, &clipped_y, &width, &height)) {
+        return 0;
+    }
+
+    source_x += clipped_x - x;
+    source_y += clipped_y - y;
+    x = clipped_x;
+    y = clipped_y;
+
+    // -- Walk the rectangle backwards when copying within the same map towards higher coordinates.
+    int step_x = ((source == this) && (x > source_x)) ? -1 : 1;
+    int step_y = ((source == this) && (y > source_y)) ? -1 : 1;
+
+    for (int row_index = 0; row_index < height; ++row_index) {
+        int row = (step_y > 0) ? row_index : (height - 1 - row_index);
+        for (int column_index = 0; column_index < width; ++column_index) {
+            int column = (step_x > 0) ? column_index : (width - 1 - column_index);
+            tilemapSetCell(this, x + column, y + row, tileStorageGet(source->map, source_x + column, source_y + row));
+        }
+    }
+
+    return 0;
+}
+
+// -- Return the solid cells of the map, finding them first if this is the first collision query, or NULL if the
+// -- tilemap has no size.
+Collision* tilemapGetCollision(Tilemap* this)
+{
+    if (this->map == NULL) {
+        return NULL;
+    }
+
+    if (this->collision != NULL) {
+        return this->collision;
+    }
+
+    this->collision = collisionNew(this->nb_of_tiles, this->arena);
+    if (this->collision == NULL) {
+        return NULL;
+    }
+
+    if (!collisionSetMap(this->collision, this->map)) {
+        collisionDelete(this->collision);
+        this->collision = NULL;
+    }
+
+    return this->collision;
+}
+
+// -- Move position, the start of a box of size along one axis, by delta pixels, stopping at the first solid cell
+// -- along the way. cross_position and cross_size give the box's extent on the other axis. Returns the normal of
+// -- the cell that stopped the box, -1 or 1, or 0 if it moved all the way.
+int tilemapSweep(Collision* collision, int horizontal, float* position, float size, float delta,
+                 float cross_position, float cross_size, int tile_size, int cross_tile_size)
+{
+    int first_cross = (int)floorf(cross_position / cross_tile_size);
+    int last_cross = (int)ceilf((cross_position + cross_size) / cross_tile_size) - 1;
+
+    int first = 0;
+    int last = 0;
+    int step = 0;
+
+    if (delta > 0.0f) {
+        first = (int)ceilf((*position + size) / tile_size);
+        last = (int)ceilf((*position + size + delta) / tile_size) - 1;
+        step = 1;
+    }
+    else if (delta < 0.0f) {
+        first = (int)floorf(*position / tile_size) - 1;
+        last = (int)floorf((*position + delta) / tile_size);
+        step = -1;
+    }
+    else {
+        return 0;
+    }
+
+    for (int cell = first; (step > 0) ? (cell <= last) : (cell >= last); cell += step) {
+        int solid = horizontal ? collisionHasSolidCells(collision, cell, first_cross, cell, last_cross) :
+                                 collisionHasSolidCells(collision, first_cross, cell, last_cross, cell);
+        if (solid) {
+            *position = (step > 0) ? ((float)(cell * tile_size) - size) : (float)((cell + 1) * tile_size);
+            return -step;
+        }
+    }
+
+    *position += delta;
+
+    return 0;
+}
+
+// -- Sets whether cells set to image index are solid or not for collision queries. All tiles are solid by default.
+// function Tilemap:setTileSolid(index, solid)
+int tilemapSetTileSolid(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    Collision* collision = tilemapGetCollision(this);
+    if (collision == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before setTileSolid().");
+        return 0;
+    }
+
+    if (collisionSetTileSolid(collision, pd->lua->getArgInt(2), pd->lua->getArgBool(3)) &&
+        !collisionSetMap(collision, this->map)) {
+        collisionDelete(collision);
+        this->collision = NULL;
+    }
+
+    return 0;
+}
+
+// -- Makes the image indices in data, a string of little endian 16 bit indices, passable and every other one solid.
+// function Tilemap:setPassableTilesFromBytes(data)
+int tilemapSetPassableTilesFromBytes(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    Collision* collision = tilemapGetCollision(this);
+    if (collision == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before setPassableTilesFromBytes().");
+        return 0;
+    }
+
+    size_t length = 0;
+    const uint8_t* data = (const uint8_t*)pd->lua->getArgBytes(2, &length);
+    if (data == NULL) {
+        DM_LOG("Tilemap: Invalid arguments for setPassableTilesFromBytes().");
+        return 0;
+    }
+
+    uint8_t* passable = dmMemoryCalloc(this->nb_of_tiles + 1, sizeof(uint8_t));
+    if (passable == NULL) {
+        DM_LOG("Tilemap: Error allocating passable tiles for %d tiles.", this->nb_of_tiles);
+        return 0;
+    }
+
+    for (size_t i = 0; (i + 1) < length; i += 2) {
+        int index = data[i] | (data[i + 1] << 8);
+        if (index <= this->nb_of_tiles) {
+            passable[index] = 1;
+        }
+    }
+
+    int changed = 0;
+    for (int index = 1; index <= this->nb_of_tiles; ++index) {
+        changed |= collisionSetTileSolid(collision, index, !passable[index]);
+    }
+
+    dmMemoryFree(passable);
+
+    if (changed && !collisionSetMap(collision, this->map)) {
+        collisionDelete(collision);
+        this->collision = NULL;
+    }
+
+    return 0;
+}
+
+// -- Returns true if the rectangle at (x, y) of size width x height, in pixels relative to the tilemap's origin,
+// -- overlaps any solid cell.
+// function Tilemap:overlapsRect(x, y, width, height)
+int tilemapOverlapsRect(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    Collision* collision = tilemapGetCollision(this);
+    if (collision == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before overlapsRect().");
+        return 0;
+    }
+
+    float x = pd->lua->getArgFloat(2);
+    float y = pd->lua->getArgFloat(3);
+    float width = pd->lua->getArgFloat(4);
+    float height = pd->lua->getArgFloat(5);
+
+    int overlaps = (width > 0.0f) && (height > 0.0f) &&
+                   collisionHasSolidCells(collision, (int)floorf(x / this->tile_width), (int)floorf(y / this->tile_height),
+                                          (int)ceilf((x + width) / this->tile_width) - 1, (int)ceilf((y + height) / this->tile_height) - 1);
+
+    pd->lua->pushBool(overlaps);
+
+    return 1;
+}
+
+// -- Returns the solid rectangles overlapping the rectangle at (x, y) of size width x height, in pixels relative to the
+// -- tilemap's origin, as a string of little endian 32 bit (x, y, width, height) pixel rectangles. Solid cells are
+// -- merged into as few rectangles as possible within each block of 32x32 cells and are cached until they change.
+// function Tilemap:getSolidRectsAsBytes(x, y, width, height)
+int tilemapGetSolidRectsAsBytes(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    Collision* collision = tilemapGetCollision(this);
+    if (collision == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before getSolidRectsAsBytes().");
+        return 0;
+    }
+
+    float x = pd->lua->getArgFloat(2);
+    float y = pd->lua->getArgFloat(3);
+    float width = pd->lua->getArgFloat(4);
+    float height = pd->lua->getArgFloat(5);
+
+    int first_x = (int)floorf(x / this->tile_width);
+    int first_y = (int)floorf(y / this->tile_height);
+    int last_x = (int)ceilf((x + width) / this->tile_width) - 1;
+    int last_y = (int)ceilf((y + height) / this->tile_height) - 1;
+
+    first_x = (first_x < 0) ? 0 : first_x;
+    first_y = (first_y < 0) ? 0 : first_y;
+    last_x = (last_x >= this->width) ? this->width - 1 : last_x;
+    last_y = (last_y >= this->height) ? this->height - 1 : last_y;
+
+    if ((last_x < first_x) || (last_y < first_y)) {
+        pd->lua->pushBytes("", 0);
+        return 1;
+    }
+
+    // -- Count the rectangles first so the result can be allocated in one go.
+    int nb_of_rects = 0;
+    uint8_t* data = NULL;
+
+    for (int pass = 0; pass < 2; ++pass) {
+        uint8_t* current = data;
+
+        for (int chunk_y = first_y >> TILE_STORAGE_CHUNK_SHIFT; chunk_y <= (last_y >> TILE_STORAGE_CHUNK_SHIFT); ++chunk_y) {
+            for (int chunk_x = first_x >> TILE_STORAGE_CHUNK_SHIFT; chunk_x <= (last_x >> TILE_STORAGE_CHUNK_SHIFT); ++chunk_x) {
+                const CollisionChunk* chunk = collisionGetChunk(collision, chunk_x, chunk_y);
+                if (chunk == NULL) {
+                    continue;
+                }
+
+                int chunk_cell_x = chunk_x << TILE_STORAGE_CHUNK_SHIFT;
+                int chunk_cell_y = chunk_y << TILE_STORAGE_CHUNK_SHIFT;
+
+                for (int i = 0; i < chunk->nb_of_rects; ++i) {
+                    const CollisionRect* rect = &chunk->rects[i];
+                    int rect_x = chunk_cell_x + rect->x;
+                    int rect_y = chunk_cell_y + rect->y;
+
+                    if ((rect_x > last_x) || ((rect_x + rect->width) <= first_x) ||
+                        (rect_y > last_y) || ((rect_y + rect->height) <= first_y)) {
+                        continue;
+                    }
+
+                    if (current == NULL) {
+                        ++nb_of_rects;
+                        continue;
+                    }
+
+                    int32_t values[4] = {
+                        rect_x * this->tile_width,
+                        rect_y * this->tile_height,
+                        rect->width * this->tile_width,
+                        rect->height * this->tile_height
+                    };
+
+                    for (int value_index = 0; value_index < 4; ++value_index) {
+                        uint32_t value = (uint32_t)values[value_index];
+                        current[0] = (uint8_t)value;
+                        current[1] = (uint8_t)(value >> 8);
+                        current[2] = (uint8_t)(value >> 16);
+                        current[3] = (uint8_t)(value >> 24);
+                        current += 4;
+                    }
+                }
+            }
+        }
+
+        if ((pass == 0) && (nb_of_rects == 0)) {
+            break;
+        }
+
+        if (pass == 0) {
+            data = dmMemoryCalloc(nb_of_rects, 16);
+            if (data == NULL) {
+                DM_LOG("Tilemap: Error allocating %d rects for getSolidRectsAsBytes().", nb_of_rects);
+                return 0;
+            }
+        }
+    }
+
+    if (data == NULL) {
+        pd->lua->pushBytes("", 0);
+        return 1;
+    }
+
+    pd->lua->pushBytes((const char*)data, nb_of_rects * 16);
+
+    dmMemoryFree(data);
+
+    return 1;
+}
+
+// -- Moves the rectangle at (x, y) of size width x height by (dx, dy), in pixels relative to the tilemap's origin,
+// -- stopping it against solid cells. The horizontal move is resolved first, then the vertical one. A rectangle
+// -- already overlapping solid cells is not pushed out of them. Returns multiple values (x, y, normalX, normalY)
+// -- where the normal on each axis is -1 or 1 if the rectangle was stopped on that axis and 0 otherwise.
+// function Tilemap:moveAndCollide(x, y, width, height, dx, dy)
+int tilemapMoveAndCollide(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    Collision* collision = tilemapGetCollision(this);
+    if (collision == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before moveAndCollide().");
+        return 0;
+    }
+
+    float x = pd->lua->getArgFloat(2);
+    float y = pd->lua->getArgFloat(3);
+    float width = pd->lua->getArgFloat(4);
+    float height = pd->lua->getArgFloat(5);
+    float dx = pd->lua->getArgFloat(6);
+    float dy = pd->lua->getArgFloat(7);
+
+    int normal_x = tilemapSweep(collision, 1, &x, width, dx, y, height, this->tile_width, this->tile_height);
+    int normal_y = tilemapSweep(collision, 0, &y, height, dy, x, width, this->tile_height, this->tile_width);
+
+    pd->lua->pushFloat(x);
+    pd->lua->pushFloat(y);
+    pd->lua->pushInt(normal_x);
+    pd->lua->pushInt(normal_y);
+
+    return 4;
+}
+
+// -- Casts a ray from (x0, y0) to (x1, y1), in pixels relative to the tilemap's origin, and returns where it first
+// -- hits a solid cell as multiple values (cellX, cellY, hitX, hitY, normalX, normalY), or nil if it doesn't. The
+// -- normal is (0, 0) if the ray starts inside a solid cell.
+// function Tilemap:raycast(x0, y0, x1, y1)
+int tilemapRaycast(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    Collision* collision = tilemapGetCollision(this);
+    if (collision == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before raycast().");
+        return 0;
+    }
+
+    CollisionHit hit;
+    if (!collisionRaycast(collision, pd->lua->getArgFloat(2), pd->lua->getArgFloat(3), pd->lua->getArgFloat(4),
+                          pd->lua->getArgFloat(5), this->tile_width, this->tile_height, &hit)) {
+        pd->lua->pushNil();
+        return 1;
+    }
+
+    pd->lua->pushInt(hit.cell_x + 1);
+    pd->lua->pushInt(hit.cell_y + 1);
+    pd->lua->pushFloat(hit.x);
+    pd->lua->pushFloat(hit.y);
+    pd->lua->pushInt(hit.normal_x);
+    pd->lua->pushInt(hit.normal_y);
+
+    return 6;
+}
+
+// -- Checks line of sight for many segments in one call. data is a string of little endian 32 bit floats, four per
+// -- segment (x0, y0, x1, y1) in pixels relative to the tilemap's origin. Returns a string with one byte per segment,
+// -- 1 if no solid cell is in the way and 0 otherwise.
+// function Tilemap:lineOfSightFromBytes(data)
+int tilemapLineOfSightFromBytes(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    Collision* collision = tilemapGetCollision(this);
+    if (collision == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before lineOfSightFromBytes().");
+        return 0;
+    }
+
+    size_t length = 0;
+    const uint8_t* data = (const uint8_t*)pd->lua->getArgBytes(2, &length);
+    if ((data == NULL) || ((length % 16) != 0)) {
+        DM_LOG("Tilemap: Invalid arguments for lineOfSightFromBytes().");
+        return 0;
+    }
+
+    int nb_of_segments = (int)(length / 16);
+    if (nb_of_segments == 0) {
+        pd->lua->pushBytes("", 0);
+        return 1;
+    }
+
+    uint8_t* results = dmMemoryCalloc(nb_of_segments, sizeof(uint8_t));
+    if (results == NULL) {
+        DM_LOG("Tilemap: Error allocating %d results for lineOfSightFromBytes().", nb_of_segments);
+        return 0;
+    }
+
+    for (int i = 0; i < nb_of_segments; ++i) {
+        float values[4];
+        for (int value_index = 0; value_index < 4; ++value_index) {
+            uint32_t bits = (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+            memcpy(&values[value_index], &bits, sizeof(float));
+            data += 4;
+        }
+
+        CollisionHit hit;
+        results[i] = !collisionRaycast(collision, values[0], values[1], values[2], values[3], this->tile_width, this->tile_height, &hit);
+    }
+
+    pd->lua->pushBytes((const char*)results, nb_of_segments);
+
+    dmMemoryFree(results);
+
+    return 1;
+}
+
+// -- Return the tile costs and search buffers for the map, creating them first if needed.
+Pathfinding* tilemapGetPathfinding(Tilemap* this)
+{
+    if ((this->pathfinding != NULL) || (this->map == NULL)) {
+        return this->pathfinding;
+    }
+
+    this->pathfinding = pathfindingNew(this->nb_of_tiles, this->arena);
+    if (this->pathfinding == NULL) {
+        return NULL;
+    }
+
+    if (!pathfindingSetMap(this->pathfinding, this->map)) {
+        pathfindingDelete(this->pathfinding);
+        this->pathfinding = NULL;
+    }
+
+    return this->pathfinding;
+}
+
+// -- Sets the cost, from 1 to 255, of walking into cells set to image index for path finding, 0 making them
+// -- impassable. index 0 sets the cost of empty cells. Empty cells cost 1 and every tile is impassable by default.
+// function Tilemap:setTileCost(index, cost)
+int tilemapSetTileCost(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    Pathfinding* pathfinding = tilemapGetPathfinding(this);
+    if (pathfinding == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set, or too big for path finding, before setTileCost().");
+        return 0;
+    }
+
+    int index = pd->lua->getArgInt(2);
+    int cost = pd->lua->getArgInt(3);
+    if (!pathfindingSetTileCost(pathfinding, index, cost)) {
+        DM_LOG("Tilemap: Invalid cost %d for image index %d in setTileCost().", cost, index);
+    }
+
+    return 0;
+}
+
+// -- Finds the cheapest path from cell (startX, startY) to cell (goalX, goalY) with A*, moving diagonally as well if
+// -- diagonals is true. Returns the cells along the path, both ends included, as a string of little endian 16 bit
+// -- (x, y) pairs, or nil if there is no path.
+// function Tilemap:findPathAsBytes(startX, startY, goalX, goalY, diagonals)
+int tilemapFindPathAsBytes(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    Pathfinding* pathfinding = tilemapGetPathfinding(this);
+    if (pathfinding == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set, or too big for path finding, before findPathAsBytes().");
+        return 0;
+    }
+
+    int path_length = pathfindingFindPath(pathfinding, pd->lua->getArgInt(2) - 1, pd->lua->getArgInt(3) - 1,
+                                          pd->lua->getArgInt(4) - 1, pd->lua->getArgInt(5) - 1, pd->lua->getArgBool(6));
+    if (path_length == 0) {
+        pd->lua->pushNil();
+        return 1;
+    }
+
+    pd->lua->pushBytes((const char*)pathfinding->path, path_length * 4);
+
+    return 1;
+}
+
+// -- Works out, for every cell, which way to walk to reach cell (goalX, goalY) as cheaply as possible, moving
+// -- diagonally as well if diagonals is true. Directions are then read with getFlowDirection() until the next call,
+// -- changes to the map are not reflected until then. Returns the number of cells the goal can be reached from.
+// function Tilemap:computeFlowField(goalX, goalY, diagonals)
+int tilemapComputeFlowField(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    Pathfinding* pathfinding = tilemapGetPathfinding(this);
+    if (pathfinding == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set, or too big for path finding, before computeFlowField().");
+        return 0;
+    }
+
+    pd->lua->pushInt(pathfindingComputeFlowField(pathfinding, pd->lua->getArgInt(2) - 1, pd->lua->getArgInt(3) - 1,
+                                                 pd->lua->getArgBool(4)));
+
+    return 1;
+}
+
+// -- Returns the step to take from cell (x, y) towards the goal of the last flow field as multiple values (dx, dy),
+// -- (0, 0) on the goal itself, or nil if the goal can't be reached from there.
+// function Tilemap:getFlowDirection(x, y)
+int tilemapGetFlowDirection(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    int dx = 0;
+    int dy = 0;
+    if ((this->pathfinding == NULL) ||
+        !pathfindingGetFlowDirection(this->pathfinding, pd->lua->getArgInt(2) - 1, pd->lua->getArgInt(3) - 1, &dx, &dy)) {
+        pd->lua->pushNil();
+        return 1;
+    }
+
+    pd->lua->pushInt(dx);
+    pd->lua->pushInt(dy);
+
+    return 2;
+}
+
+// -- Return the terrains and autotile rules for the map, creating them first if needed.
+Autotile* tilemapGetAutotile(Tilemap* this)
+{
+    if ((this->autotile != NULL) || (this->map == NULL)) {
+        return this->autotile;
+    }
+
+    this->autotile = autotileNew(this->arena);
+    if (this->autotile == NULL) {
+        return NULL;
+    }
+
+    autotileSetMap(this->autotile, this->map);
+
+    return this->autotile;
+}
+
+// -- Pick the tile of every cell with a terrain in the rectangle of cells at (x, y) of size width x height, 0-based,
+// -- from its neighbours. Parts of the rectangle outside of the tilemap are ignored.
+void tilemapAutotileRect(Tilemap* this, int x, int y, int width, int height)
+{
+    const Autotile* autotile = this->autotile;
+    if ((autotile->chunks == NULL) || !tilemapClipRect(this, &x, &y, &width, &height)) {
+        return;
+    }
+
+    int last_x = x + width - 1;
+    int last_y = y + height - 1;
+
+    // -- Only chunks with some terrain set can have cells to update.
+    for (int chunk_y = y >> TILE_STORAGE_CHUNK_SHIFT; chunk_y <= (last_y >> TILE_STORAGE_CHUNK_SHIFT); ++chunk_y) {
+        int chunk_first_y = chunk_y << TILE_STORAGE_CHUNK_SHIFT;
+        int first_row = (y > chunk_first_y) ? y : chunk_first_y;
+        int last_row = (last_y < (chunk_first_y + TILE_STORAGE_CHUNK_MASK)) ? last_y : (chunk_first_y + TILE_STORAGE_CHUNK_MASK);
+
+        for (int chunk_x = x >> TILE_STORAGE_CHUNK_SHIFT; chunk_x <= (last_x >> TILE_STORAGE_CHUNK_SHIFT); ++chunk_x) {
+            if (autotileGetChunk(autotile, chunk_x, chunk_y) == NULL) {
+                continue;
+            }
+
+            int chunk_first_x = chunk_x << TILE_STORAGE_CHUNK_SHIFT;
+            int first_column = (x > chunk_first_x) ? x : chunk_first_x;
+            int last_column = (last_x < (chunk_first_x + TILE_STORAGE_CHUNK_MASK)) ? last_x : (chunk_first_x + TILE_STORAGE_CHUNK_MASK);
+
+            for (int row = first_row; row <= last_row; ++row) {
+                for (int column = first_column; column <= last_column; ++column) {
+                    uint16_t value;
+                    if (autotileGetTile(autotile, column, row, &value)) {
+                        tilemapSetCell(this, column, row, value);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// -- Sets the autotile rules for terrain, from 1 to 32, from a string of little endian 16 bit tile indices which
+// -- can hold a flip like setTilesFromBytes(). With 16 indices, the 4-bit ruleset, index mask + 1 is used for cells
+// -- whose neighbour mask is mask, where north is 1, east 2, south 4 and west 8 if that neighbour has the same
+// -- terrain. With 47 indices, the blob ruleset, the mask also has north-east 16, south-east 32, south-west 64 and
+// -- north-west 128, only set if both sides next to that corner are set too, and the indices are for the 47
+// -- possible masks in increasing order. Cells outside the map count as having the same terrain. Cells already
+// -- painted with terrain are updated.
+// function Tilemap:setAutotileRulesFromBytes(terrain, data)
+int tilemapSetAutotileRulesFromBytes(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    Autotile* autotile = tilemapGetAutotile(this);
+    if (autotile == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before setAutotileRulesFromBytes().");
+        return 0;
+    }
+
+    int terrain = pd->lua->getArgInt(2);
+
+    size_t length = 0;
+    const uint8_t* data = (const uint8_t*)pd->lua->getArgBytes(3, &length);
+    if ((data == NULL) || ((length != (AUTOTILE_NB_OF_FOUR_BIT_TILES * 2)) && (length != (AUTOTILE_NB_OF_BLOB_TILES * 2)))) {
+        DM_LOG("Tilemap: Autotile rules need %d or %d tile indices for setAutotileRulesFromBytes().",
+               AUTOTILE_NB_OF_FOUR_BIT_TILES, AUTOTILE_NB_OF_BLOB_TILES);
+        return 0;
+    }
+
+    int nb_of_tiles = (int)(length / 2);
+    uint16_t tiles[AUTOTILE_NB_OF_BLOB_TILES];
+    for (int index = 0; index < nb_of_tiles; ++index) {
+        tiles[index] = (uint16_t)(data[index * 2] | (data[(index * 2) + 1] << 8));
+    }
+
+    if (!autotileSetRules(autotile, terrain, tiles, nb_of_tiles)) {
+        DM_LOG("Tilemap: Invalid terrain %d for setAutotileRulesFromBytes().", terrain);
+        return 0;
+    }
+
+    tilemapAutotileRect(this, 0, 0, this->width, this->height);
+
+    return 0;
+}
+
+// -- Returns the terrain and autotile rules for the map and checks that terrain can be painted with. Returns NULL
+// -- on error.
+static Autotile* tilemapGetAutotileArg(Tilemap* this, int terrain, const char* function)
+{
+    Autotile* autotile = tilemapGetAutotile(this);
+    if (autotile == NULL) {
+        DM_LOG("Tilemap: Size of tilemap not set before %s().", function);
+        return NULL;
+    }
+
+    if ((terrain < 0) || (terrain > AUTOTILE_MAX_TERRAINS) || ((terrain != 0) && (autotile->rules[terrain - 1] == NULL))) {
+        DM_LOG("Tilemap: No autotile rules set for terrain %d in %s().", terrain, function);
+        return NULL;
+    }
+
+    return autotile;
+}
+
+// -- Paints terrain at tilemap position (x, y) and picks the tiles of that cell and its 8 neighbours from the
+// -- autotile rules. terrain 0 removes the terrain and empties the cell.
+// function Tilemap:setTerrainAt(x, y, terrain)
+int tilemapSetTerrainAt(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    int terrain = pd->lua->getArgInt(4);
+    Autotile* autotile = tilemapGetAutotileArg(this, terrain, "setTerrainAt");
+    if (autotile == NULL) {
+        return 0;
+    }
+
+    int x = pd->lua->getArgInt(2) - 1;
+    int y = pd->lua->getArgInt(3) - 1;
+
+    if ((x < 0) || (x >= this->width) || (y < 0) || (y >= this->height)) {
+        DM_LOG("Tilemap: Out of bounds values %d,%d for setTerrainAt().", x + 1, y + 1);
+        return 0;
+    }
+
+    if ((terrain != 0) && (autotileGetTerrain(autotile, x, y) == terrain)) {
+        return 0;
+    }
+
+    if (!autotileSetTerrain(autotile, x, y, terrain)) {
+        return 0;
+    }
+
+    if (terrain == 0) {
+        tilemapSetCell(this, x, y, 0);
+    }
+
+    tilemapAutotileRect(this, x - 1, y - 1, 3, 3);
+
+    return 0;
+}
+
+// -- Returns the terrain painted at tilemap position (x, y), 0 if there is none. If x or y is out of bounds,
+// -- returns nil.
+// function Tilemap:getTerrainAt(x, y)
+int tilemapGetTerrainAt(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    int x = pd->lua->getArgInt(2) - 1;
+    int y = pd->lua->getArgInt(3) - 1;
+
+    if ((this->map == NULL) || (x < 0) || (x >= this->width) || (y < 0) || (y >= this->height)) {
+        pd->lua->pushNil();
+        return 1;
+    }
+
+    pd->lua->pushInt((this->autotile != NULL) ? autotileGetTerrain(this->autotile, x, y) : 0);
+
+    return 1;
+}
+
+// -- Paints terrain in the rectangle at (x, y) of size width x height, then picks the tiles of the rectangle and
+// -- the cells around it in one pass. terrain 0 removes the terrain and empties the cells. Parts of the rectangle
+// -- outside of the tilemap are ignored.
+// function Tilemap:fillTerrainRect(x, y, width, height, terrain)
+int tilemapFillTerrainRect(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    int terrain = pd->lua->getArgInt(6);
+    Autotile* autotile = tilemapGetAutotileArg(this, terrain, "fillTerrainRect");
+    if (autotile == NULL) {
+        return 0;
+    }
+
+    int x = pd->lua->getArgInt(2) - 1;
+    int y = pd->lua->getArgInt(3) - 1;
+    int width = pd->lua->getArgInt(4);
+    int height = pd->lua->getArgInt(5);
+
+    if (!tilemapClipRect(this, &x, &y, &width, &height)) {
+        return 0;
+    }
+
+    for (int row = y; row < (y + height); ++row) {
+        for (int column = x; column < (x + width); ++column) {
+            if (!autotileSetTerrain(autotile, column, row, terrain)) {
+                return 0;
+            }
+
+            if (terrain == 0) {
+                tilemapSetCell(this, column, row, 0);
+            }
+        }
+    }
+
+    tilemapAutotileRect(this, x - 1, y - 1, width + 2, height + 2);
+
+    return 0;
+}
+
+// -- Sets the tilemap’s width and height, in number of tiles.
+// function Tilemap:setSize(width, height)
+int tilemapSetSize(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    int width = pd->lua->getArgInt(2);
+    int height = pd->lua->getArgInt(3);
+
+    tilemapStopLoading(this);
+
+    // -- The old map is gone even if the new size is refused, leaving the tilemap empty.
+    if (this->map != NULL) {
+        tileStorageDelete(this->map);
+        this->map = NULL;
+    }
+
+    this->width = 0;
+    this->height = 0;
+
+    if ((width <= 0) || (width > TILEMAP_MAX_SIZE) || (height <= 0) || (height > TILEMAP_MAX_SIZE)) {
+        DM_LOG("Tilemap: Trying to set an invalid size of %dx%d.", width, height);
+        tilemapMapChanged(this);
+        return 0;
+    }
+
+    this->map = tileStorageNew(width, height, this->arena);
+    if (this->map == NULL) {
+        DM_LOG("Tilemap: Error allocating a map of %dx%d tiles.", width, height);
+        tilemapMapChanged(this);
+        return 0;
+    }
+
+    this->width = width;
+    this->height = height;
+
+    tilemapMapChanged(this);
+
+    return 0;
+}
+
+// -- Replaces the tilemap's size and content with the ones stored in a binary map file (see MapFile.h).
+// -- Returns true if the map was loaded, false otherwise, in which case the tilemap is left unchanged.
+// function Tilemap:loadMap(path)
+int tilemapLoadMap(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    const char* path = pd->lua->getArgString(2);
+    if (path == NULL) {
+        DM_LOG("Tilemap: Error getting map path argument.");
+        return 0;
+    }
+
+    TileStorage* map = mapFileLoad(path, TILEMAP_MAX_SIZE, this->arena);
+    if (map == NULL) {
+        pd->lua->pushBool(0);
+        return 1;
+    }
+
+    tilemapStopLoading(this);
+
+    if (this->map != NULL) {
+        tileStorageDelete(this->map);
+    }
+
+    this->map = map;
+    this->width = map->width;
+    this->height = map->height;
+
+    tilemapMapChanged(this);
+
+    pd->lua->pushBool(1);
+
+    return 1;
+}
+
+// -- Starts replacing the tilemap's size and content with the ones stored in a binary map file (see MapFile.h),
+// -- without reading any of its cells yet. The map is then empty, at its new size, and filled by calls to
+// -- continueLoadingMap(). Returns true if the file could be opened, false otherwise, in which case the tilemap is
+// -- left unchanged.
+// function Tilemap:startLoadingMap(path)
+int tilemapStartLoadingMap(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    const char* path = pd->lua->getArgString(2);
+    if (path == NULL) {
+        DM_LOG("Tilemap: Error getting map path argument.");
+        return 0;
+    }
 
-typedef struct {
-    LCDBitmap* bitmap;
-    int x, y;
-} Tile;
+    MapFileReader* loader = mapFileOpen(path, TILEMAP_MAX_SIZE);
+    if (loader == NULL) {
+        pd->lua->pushBool(0);
+        return 1;
+    }
 
-// -- Tilemap class
-typedef struct {
-    LCDBitmapTable* image_table;
+    int width = mapFileGetWidth(loader);
+    int height = mapFileGetHeight(loader);
 
-    int height;
-    int width;
+    TileStorage* map = tileStorageNew(width, height, this->arena);
+    if (map == NULL) {
+        DM_LOG("Tilemap: Error allocating a map of %dx%d tiles.", width, height);
+        mapFileClose(loader);
+        pd->lua->pushBool(0);
+        return 1;
+    }
 
-    int tile_width;
-    int tile_height;
+    tilemapStopLoading(this);
 
-    int nb_of_tiles;
-    Tile* tiles;
-    
-    uint16_t* map;
-} Tilemap;
+    if (this->map != NULL) {
+        tileStorageDelete(this->map);
+    }
 
-// -- Get an argument as a Tilemap class
-#define GET_TILEMAP_ARG(index)    pd->lua->getArgObject(index, CLASSNAME_TILEMAP, NULL);
+    this->map = map;
+    this->width = width;
+    this->height = height;
+    this->loader = loader;
 
-// -- Register the class
-extern void register_Tilemap(PlaydateAPI* api)
-{
-    const char* err = NULL;
-    
-    // -- Register Tilemap
-    if (!pd->lua->registerClass(CLASSNAME_TILEMAP, tilemapClass, NULL, 0, &err))
-    {
-        DM_LOG("dm.Tilemap: Failed to register the Tilemap class (%s).", err);
-        return;
-    }
-    
-    register_OldCTilemap(api);
+    tilemapMapChanged(this);
+
+    pd->lua->pushBool(1);
+
+    return 1;
 }
 
-void setupTiles(Tilemap* this)
+// -- Reads more of the map file passed to startLoadingMap(), for about budgetMicroseconds. At least one batch of
+// -- rows is read per call. Returns whether the map is fully loaded and how much of it is, from 0.0 to 1.0, or nil
+// -- on a read error, in which case loading stops and the rows read so far stay in the map. The loaded rows can be
+// -- drawn at any time, cells set in rows not loaded yet may be overwritten.
+// function Tilemap:continueLoadingMap(budgetMicroseconds)
+int tilemapContinueLoadingMap(lua_State* L)
 {
-    int display_width = pd->display->getWidth();
-    int display_height = pd->display->getHeight();
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
 
-    int map_width_in_tiles = display_width / this->tile_width;
-    int map_height_in_tiles = display_height / this->tile_height;
-    
-    this->nb_of_tiles = map_width_in_tiles * map_height_in_tiles;
-    this->tiles = dmMemoryCalloc(this->nb_of_tiles, sizeof(Tile));
+    if (this->loader == NULL) {
+        pd->lua->pushBool(1);
+        pd->lua->pushFloat(1.0f);
+        return 2;
+    }
 
-    int image_width = this->tile_width;
-    int image_height = this->tile_height;
+    int budget = pd->lua->getArgInt(2);
+    float start_time = pd->system->getElapsedTime();
 
-    int draw_x = 0;
-    int draw_y = 0;
-    
-    int tile_x = 0;
-    int tile_y = 0;
-    
-    int current_tile_x = 0;
-    int current_tile_y = 0;
-    
-    int current_draw_x = 0;
-    int current_draw_y = 0;
-    
-    int width = this->width;
-    int height = this->height;
-    uint16_t* tilemap = this->map;
-    LCDBitmapTable* table = this->image_table;
-
-    Tile* current_tile = this->tiles;    
-    int tilemap_index = (current_tile_y * width) + current_tile_x;
-    while((current_draw_y < display_height) && (current_tile_y < height)) {
-        int next_tilemap_index_offset = width;
-    
-        while((current_draw_x < display_width) && (current_tile_x < width)) {
-            int tile_index = tilemap[tilemap_index] - 1;
-            if (tile_index != 0) {
-            
-                if (current_tile >= this->tiles + this->nb_of_tiles) {
-                    DM_LOG("BOOM");
-                    return;
-                }
-                
-                current_tile->bitmap = pd->graphics->getTableBitmap(this->image_table, tile_index);
-                current_tile->x = current_draw_x;
-                current_tile->y = current_draw_y;
+    int nb_of_rows_per_batch = TILEMAP_LOAD_CELLS_PER_BATCH / this->width;
+    if (nb_of_rows_per_batch == 0) {
+        nb_of_rows_per_batch = 1;
+    }
+
+    int first_row = mapFileGetCurrentRow(this->loader);
+    int ok = 1;
+
+    do {
+        ok = mapFileReadRows(this->loader, this->map, nb_of_rows_per_batch);
+    }
+    while (ok && !mapFileIsComplete(this->loader) &&
+           (((pd->system->getElapsedTime() - start_time) * 1000000.0f) < (float)budget));
+
+    int last_row = mapFileGetCurrentRow(this->loader);
+
+    // -- Cells were stored directly so anything already drawn from the rows read has to be redrawn.
+    if ((this->chunks != NULL) && (last_row > first_row)) {
+        int first_chunk_y = first_row / this->chunk_size;
+        int last_chunk_y = (last_row - 1) / this->chunk_size;
+        for (int chunk_y = first_chunk_y; chunk_y <= last_chunk_y; ++chunk_y) {
+            for (int chunk_x = 0; chunk_x < this->chunks_wide; ++chunk_x) {
+                tilemapInvalidateChunk(this, (chunk_y * this->chunks_wide) + chunk_x);
             }
-    
-            next_tilemap_index_offset -= 1;
-            tilemap_index += 1;
-    
-            current_draw_x += image_width;
-            current_tile_x += 1;
-            
-            ++current_tile;
         }
-    
-        tilemap_index += next_tilemap_index_offset;
-    
-        current_tile_x = tile_x;
-        current_tile_y += 1;
-    
-        current_draw_x = draw_x;
-        current_draw_y += image_height;
     }
+
+    if (this->overview != NULL) {
+        tilemapDrawOverviewRows(this, first_row, last_row);
+    }
+
+    this->needs_full_redraw = 1;
+
+    if (!ok) {
+        tilemapStopLoading(this);
+        return 0;
+    }
+
+    int done = mapFileIsComplete(this->loader);
+    if (done) {
+        tilemapStopLoading(this);
+
+        // -- Solid cells are worked out once the whole map is there rather than cell by cell.
+        if ((this->collision != NULL) && !collisionSetMap(this->collision, this->map)) {
+            collisionDelete(this->collision);
+            this->collision = NULL;
+        }
+    }
+
+    pd->lua->pushBool(done);
+    pd->lua->pushFloat((float)last_row / (float)this->height);
+
+    return 2;
 }
 
-// -- Allocate a new tilemap
-int tilemapNew(lua_State* L)
+// -- Makes every cell set to image baseIndex cycle through the frames consecutive images starting at baseIndex,
+// -- showing each one for frameDurationMs milliseconds. This is resolved when drawing, the map itself is left
+// -- unchanged. Setting frames to 1 removes the animation.
+// function Tilemap:setAnimation(baseIndex, frames, frameDurationMs)
+int tilemapSetAnimation(lua_State* L)
 {
-    Tilemap* this = dmMemoryCalloc(1, sizeof(Tilemap));
-    if (this == NULL) {
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
         return 0;
     }
 
-    const char* path = pd->lua->getArgString(1);
-    if (path == NULL) {
-        DM_LOG("Tilemap: Error getting tilemap path argument.");
+    int base_index = pd->lua->getArgInt(2);
+    int nb_of_frames = pd->lua->getArgInt(3);
+    int frame_duration = pd->lua->getArgInt(4);
+
+    if ((base_index < 1) || (nb_of_frames < 1) || ((base_index + nb_of_frames - 1) > this->nb_of_tiles) ||
+        ((nb_of_frames > 1) && (frame_duration <= 0))) {
+        DM_LOG("Tilemap: Invalid animation %d,%d,%d for setAnimation().", base_index, nb_of_frames, frame_duration);
         return 0;
     }
 
-    const char* err = NULL;
-    this->image_table = pd->graphics->loadBitmapTable(path, &err);
-    if (this->image_table == NULL) {
-        DM_LOG("Tilemap: Error loading image table '%s' (%s).", path, (err != NULL) ? err : "Unknown Error");
-        return 0;
+    if (this->displayed_tiles == NULL) {
+        this->displayed_tiles = dmMemoryCalloc(this->nb_of_tiles, sizeof(uint16_t));
+        this->tile_animations = dmMemoryCalloc(this->nb_of_tiles, sizeof(uint8_t));
+        if ((this->displayed_tiles == NULL) || (this->tile_animations == NULL)) {
+            DM_LOG("Tilemap: Error allocating animations for %d tiles.", this->nb_of_tiles);
+
+            // -- The rest of the code only checks displayed_tiles so both have to be gone.
+            dmMemoryFree(this->displayed_tiles);
+            dmMemoryFree(this->tile_animations);
+            this->displayed_tiles = NULL;
+            this->tile_animations = NULL;
+            return 0;
+        }
+
+        for (int index = 0; index < this->nb_of_tiles; ++index) {
+            this->displayed_tiles[index] = (uint16_t)index;
+        }
     }
 
-    this->nb_of_tiles = *(uint16_t*)this->image_table;
-    
-    this->height = 0;
-    this->width = 0;
+    int animation_index = this->tile_animations[base_index - 1] - 1;
 
-    LCDBitmap* bitmap = pd->graphics->getTableBitmap(this->image_table, 1);
-    if (bitmap == NULL) {
-        DM_LOG("Tilemap: Error getting bitmap from image table '%s'.", path);
-        return 0;
+    if (nb_of_frames == 1) {
+        if (animation_index >= 0) {
+            // -- Move the last animation into the freed slot.
+            int last_index = this->nb_of_animations - 1;
+            this->animations[animation_index] = this->animations[last_index];
+            this->tile_animations[this->animations[animation_index].base_index - 1] = (uint8_t)(animation_index + 1);
+            --this->nb_of_animations;
+
+            this->tile_animations[base_index - 1] = 0;
+            this->displayed_tiles[base_index - 1] = (uint16_t)(base_index - 1);
+        }
     }
+    else {
+        if (animation_index < 0) {
+            if (this->nb_of_animations == TILEMAP_MAX_ANIMATIONS) {
+                DM_LOG("Tilemap: Can't have more than %d animations.", TILEMAP_MAX_ANIMATIONS);
+                return 0;
+            }
 
-    int width, height;
-    pd->graphics->getBitmapData(bitmap, &width, &height, NULL, NULL, NULL);
+            animation_index = this->nb_of_animations++;
+            this->tile_animations[base_index - 1] = (uint8_t)(animation_index + 1);
+        }
 
-    this->tile_height = width;
-    this->tile_width = height;
-    
-    pd->graphics->freeBitmap(bitmap);
+        TilemapAnimation* animation = &this->animations[animation_index];
+        animation->base_index = base_index;
+        animation->nb_of_frames = nb_of_frames;
+        animation->frame_duration = frame_duration;
+        animation->current_frame = -1;
+    }
 
-    this->map = NULL;
+    // -- Which cells are animated changed so nothing drawn before can be trusted.
+    if (this->chunks != NULL) {
+        tilemapInvalidateAnimatedChunks(this, 1);
+    }
 
-    pd->lua->pushObject(this, CLASSNAME_TILEMAP, 0);
+    this->needs_full_redraw = 1;
 
-    return 1;
+    return 0;
 }
- 
-// -- Delete the tilemap
-int tilemapDelete(lua_State* L)
+
+// -- Enables or disables incremental drawing. When enabled, draw() assumes nothing else draws to the screen
+// -- and only redraws the parts of the previous frame that scrolled in or changed, using backgroundColor
+// -- (defaults to white) behind empty or transparent tiles. Calling this again forces a full redraw.
+// function Tilemap:setIncrementalDraw(enabled, backgroundColor)
+int tilemapSetIncrementalDraw(lua_State* L)
 {
     Tilemap* this = GET_TILEMAP_ARG(1);
     if(this == NULL) {
         DM_LOG("Tilemap: Error getting 'self' argument.");
         return 0;
     }
-    
-    if (this->image_table != NULL) {
-        pd->graphics->freeBitmapTable(this->image_table);
-        this->image_table = NULL;
-    }
-    
-    if (this->tiles != NULL) {
-        dmMemoryFree(this->tiles);
-        this->tiles = NULL;
-        this->nb_of_tiles = 0;
-    }
-    
-    if (this->map != NULL) {
-        dmMemoryFree(this->map);
-        this->map = NULL;
-    }
-    
-    dmMemoryFree(this);
-    
+
+    this->incremental_draw = pd->lua->getArgBool(2);
+    this->background_color = pd->lua->argIsNil(3) ? kColorWhite : (LCDColor)pd->lua->getArgInt(3);
+    this->needs_full_redraw = 1;
+    this->nb_of_dirty_cells = 0;
+
     return 0;
 }
 
-// -- Draws the tile map at screen coordinate (x, y).
-// -- sourceRect, if specified, will cause only the part of the tilemap within sourceRect to be drawn.
-// function Tilemap:draw(x, y, _sourceRect)
-int tilemapDraw(lua_State* L)
+// -- Enables caching the tilemap as pre-rendered chunks of chunkSize x chunkSize tiles, baked the first time
+// -- they are drawn. Least recently drawn chunks are freed once the cache uses more than budgetInBytes.
+// -- A chunkSize of 0 disables the cache.
+// function Tilemap:setChunkCache(chunkSize, budgetInBytes)
+int tilemapSetChunkCache(lua_State* L)
 {
     Tilemap* this = GET_TILEMAP_ARG(1);
     if(this == NULL) {
         DM_LOG("Tilemap: Error getting 'self' argument.");
         return 0;
     }
-    
-    if (this->tiles == NULL) {
-        setupTiles(this);
-    }
 
-    if (this->map == NULL) {
-        DM_LOG("Tilemap: Size of tilemap not set before draw().");
+    int chunk_size = pd->lua->getArgInt(2);
+    int chunk_budget = pd->lua->getArgInt(3);
+
+    if ((chunk_size < 0) || (chunk_budget < 0)) {
+        DM_LOG("Tilemap: Invalid chunk cache settings %d,%d.", chunk_size, chunk_budget);
         return 0;
     }
-    
-    int image_width = this->tile_width;
-    int image_height = this->tile_height;
 
-    int x = pd->lua->getArgInt(2);
-    int y = pd->lua->getArgInt(3);
+    this->chunk_size = chunk_size;
+    this->chunk_budget = chunk_budget;
 
-    pd->graphics->pushContext(NULL);
-    pd->graphics->setDrawOffset(x, y);
+    tilemapSetupChunks(this);
 
-    int draw_x = x;
-    int draw_y = y;
+    this->needs_full_redraw = 1;
 
-    int tile_x = 0;
-    int tile_y = 0;
+    return 0;
+}
 
-    if (draw_x < -image_width) {
-        draw_x = -(-draw_x % image_width);
-        tile_x = (int)((draw_x - x) / image_width);
+// -- Returns the memory currently used by the chunk cache, in bytes.
+// function Tilemap:getChunkCacheMemory()
+int tilemapGetChunkCacheMemory(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
     }
 
-    if (tile_x < this->width) {
-        if (draw_y < -image_height) {
-            draw_y = -(-draw_y % image_height);
-            tile_y = (int)((draw_y - y) / image_height);
-        }
-        
-        if (tile_y < this->height) {
-            Tile* current_tile = this->tiles;
-            for (int i = 0; i < this->nb_of_tiles; ++i) {
-                LCDBitmap* bitmap = current_tile->bitmap;
-                if (bitmap != NULL) {
-                    pd->graphics->drawBitmap(bitmap, current_tile->x, current_tile->y, kBitmapUnflipped);
-                }
-            
-                ++current_tile;
-            }
-        }
-        
-    }
+    pd->lua->pushInt(this->chunk_memory);
 
+    return 1;
+}
 
-    pd->graphics->popContext();
+// -- Enables or disables drawing tiles by writing straight into the frame buffer instead of calling drawBitmap().
+// -- The output is identical as long as the draw mode is kDrawModeCopy and no stencil is set. Direct drawing
+// -- always targets the screen, even if an image context was pushed.
+// function Tilemap:setDirectDraw(enabled)
+int tilemapSetDirectDraw(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    this->direct_draw = pd->lua->getArgBool(2);
+    if (this->direct_draw) {
+        tilemapSetupTileData(this);
+        tilemapSelectKernels(this);
+    }
 
     return 0;
 }
 
-// -- Sets the index of the tile at tilemap position (x, y). index is the (1-based) index of the image
-// -- in the tilemap’s playdate.graphics.imagetable.
-// function Tilemap:setTileAtPosition(x, y, index)
-int tilemapSetTileAtPosition(lua_State* L)
+// -- Enables or disables packing the tiles into an atlas used when drawing directly. Each tile row is then a single
+// -- aligned word, and copies of the tiles shifted to each horizontal position they are drawn at are made as needed
+// -- so drawing them needs no bit shifting. preshiftBudget (defaults to 64KB) caps the memory used by these copies
+// -- in bytes, tiles without one are shifted while drawing. Only tiles up to 32 pixels wide can be packed.
+// function Tilemap:setTileAtlas(enabled, preshiftBudget)
+int tilemapSetTileAtlas(lua_State* L)
 {
     Tilemap* this = GET_TILEMAP_ARG(1);
     if(this == NULL) {
         DM_LOG("Tilemap: Error getting 'self' argument.");
         return 0;
     }
-    
-    if (this->map == NULL) {
-        DM_LOG("Tilemap: Size of tilemap not set before setTileAtPosition().");
+
+    if (this->atlas != NULL) {
+        blitterAtlasDelete(this->atlas);
+        this->atlas = NULL;
+    }
+
+    if (!pd->lua->getArgBool(2)) {
         return 0;
     }
-    
-    int x = pd->lua->getArgInt(2);
-    int y = pd->lua->getArgInt(3);
-    
-    if ((x < 1) || (x > this->width) || (y < 1) || (y > this->height)) {
-        DM_LOG("Tilemap: Out of bounds values %d,%s for getTileAtPosition.", x, y);
+
+    int preshift_budget = pd->lua->argIsNil(3) ? TILEMAP_DEFAULT_PRESHIFT_BUDGET : pd->lua->getArgInt(3);
+    if (preshift_budget < 0) {
+        DM_LOG("Tilemap: Invalid pre-shift budget %d for setTileAtlas().", preshift_budget);
         return 0;
     }
 
-    int tilemap_index = pd->lua->getArgInt(4);
-    if (tilemap_index < 0) {
-        DM_LOG("Tilemap: Out of bounds tile index %d for getTileAtPosition.", tilemap_index);
+    tilemapSetupTileData(this);
+    if (this->tile_data == NULL) {
         return 0;
     }
-    
-    this->map[((y - 1) * this->width) + (x - 1)] = tilemap_index;
+
+    this->atlas = blitterAtlasNew(this->tile_data, this->nb_of_tiles, preshift_budget);
 
     return 0;
 }
 
-// -- Returns the image index of the tile at the given x and y coordinate. If x or y is out of bounds, returns nil.
-// function Tilemap:getTileAtPosition(x, y)
-int tilemapGetTileAtPosition(lua_State* L)
+// -- Returns the memory currently used by the tile atlas, including pre-shifted tiles, in bytes.
+// function Tilemap:getTileAtlasMemory()
+int tilemapGetTileAtlasMemory(lua_State* L)
 {
     Tilemap* this = GET_TILEMAP_ARG(1);
     if(this == NULL) {
@@ -310,27 +2890,58 @@ int tilemapGetTileAtPosition(lua_State* L)
         return 0;
     }
 
+    pd->lua->pushInt((this->atlas != NULL) ? this->atlas->memory : 0);
+
+    return 1;
+}
+
+// -- Returns the overview at scale, checking it and the map first. Returns NULL on error.
+static LCDBitmap* tilemapGetOverviewArg(Tilemap* this, int scale, const char* function)
+{
     if (this->map == NULL) {
-        DM_LOG("Tilemap: Size of tilemap not set before getTileAtPosition().");
+        DM_LOG("Tilemap: Size of tilemap not set before %s().", function);
+        return NULL;
+    }
+
+    if ((scale < 1) || (scale > TILEMAP_MAX_OVERVIEW_SCALE)) {
+        DM_LOG("Tilemap: Invalid overview scale %d for %s().", scale, function);
+        return NULL;
+    }
+
+    return tilemapGetOverview(this, scale);
+}
+
+// -- Returns a playdate.graphics.image of the whole map where each cell is scale x scale pixels (scale defaults to 1),
+// -- dithered to how dark its tile is on average. The overview is kept up to date as cells change, only the first
+// -- call at a given scale goes through the whole map. The image returned is a copy, call this again to see changes.
+// function Tilemap:getOverview(scale)
+int tilemapGetOverviewImage(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
         return 0;
     }
 
-    int x = pd->lua->getArgInt(2);
-    int y = pd->lua->getArgInt(3);
+    LCDBitmap* overview = tilemapGetOverviewArg(this, pd->lua->argIsNil(2) ? 1 : pd->lua->getArgInt(2), "getOverview");
+    if (overview == NULL) {
+        return 0;
+    }
 
-    if ((x < 1) || (x > this->width) || (y < 1) || (y > this->height)) {
-        DM_LOG("Tilemap: Out of bounds values %d,%s for getTileAtPosition.", x, y);
+    LCDBitmap* copy = pd->graphics->copyBitmap(overview);
+    if (copy == NULL) {
+        DM_LOG("Tilemap: Error copying the overview.");
         return 0;
     }
 
-    pd->lua->pushInt(this->map[((y - 1) * this->width) + (x - 1)]);
+    pd->lua->pushBitmap(copy);
 
     return 1;
 }
 
-// -- Sets the tilemap’s width and height, in number of tiles.
-// function Tilemap:setSize(width, height)
-int tilemapSetSize(lua_State* L)
+// -- Draws the same overview as getOverview() at (x, y) without making a copy of it.
+// function Tilemap:drawOverview(x, y, scale)
+int tilemapDrawOverview(lua_State* L)
 {
     Tilemap* this = GET_TILEMAP_ARG(1);
     if(this == NULL) {
@@ -338,24 +2949,147 @@ int tilemapSetSize(lua_State* L)
         return 0;
     }
 
-    if (this->map != NULL) {
-        dmMemoryFree(this->map);
-        this->map = NULL;
+    LCDBitmap* overview = tilemapGetOverviewArg(this, pd->lua->argIsNil(4) ? 1 : pd->lua->getArgInt(4), "drawOverview");
+    if (overview == NULL) {
+        return 0;
     }
-    
-    this->width = pd->lua->getArgInt(2);
-    this->height = pd->lua->getArgInt(3);
 
-    if ((this->width == 0) || (this->width > 2048) || (this->height == 0) || (this->height > 2048)) {
-        DM_LOG("Tilemap: Trying to set an invalid size of %dx%d.", this->width, this->height);
+    pd->graphics->drawBitmap(overview, pd->lua->getArgInt(2), pd->lua->getArgInt(3), kBitmapUnflipped);
+
+    return 0;
+}
+
+#ifdef TILEMAP_STATS_ENABLE
+// -- Start collecting statistics for a new draw.
+void tilemapStatsBeginDraw(Tilemap* this)
+{
+    memset(&this->stats, 0, sizeof(TilemapStats));
+
+    this->draw_start_time = pd->system->getElapsedTime();
+}
+
+// -- Finish collecting statistics for the current draw and add them to the totals.
+void tilemapStatsEndDraw(Tilemap* this)
+{
+    TilemapStats* stats = &this->stats;
+
+    stats->elapsed_time = (int)((pd->system->getElapsedTime() - this->draw_start_time) * 1000000.0f);
+    stats->nb_of_cells_visited = this->nb_of_cells_visited;
+
+    // -- Empty cells are never visited so they are skipped without being looked at.
+    stats->nb_of_tiles_skipped += this->nb_of_cells_in_view - this->nb_of_cells_visited;
+
+    TilemapStats* total_stats = &this->total_stats;
+    total_stats->nb_of_cells_visited += stats->nb_of_cells_visited;
+    total_stats->nb_of_tiles_drawn += stats->nb_of_tiles_drawn;
+    total_stats->nb_of_tiles_skipped += stats->nb_of_tiles_skipped;
+    total_stats->nb_of_tiles_culled += stats->nb_of_tiles_culled;
+    total_stats->nb_of_context_pushes += stats->nb_of_context_pushes;
+    total_stats->elapsed_time += stats->elapsed_time;
+
+    this->frame_times[this->nb_of_draws % TILEMAP_STATS_HISTORY] = stats->elapsed_time;
+    if (this->nb_of_frame_times < TILEMAP_STATS_HISTORY) {
+        ++this->nb_of_frame_times;
+    }
+
+    ++this->nb_of_draws;
+}
+
+// -- Write value as a little endian 32 bit integer and return where the next one goes.
+static uint8_t* tilemapPackStat(uint8_t* data, int value)
+{
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+
+    return data + 4;
+}
+
+static uint8_t* tilemapPackStats(uint8_t* data, const TilemapStats* stats)
+{
+    data = tilemapPackStat(data, stats->nb_of_cells_visited);
+    data = tilemapPackStat(data, stats->nb_of_tiles_drawn);
+    data = tilemapPackStat(data, stats->nb_of_tiles_skipped);
+    data = tilemapPackStat(data, stats->nb_of_tiles_culled);
+    data = tilemapPackStat(data, stats->nb_of_context_pushes);
+
+    return tilemapPackStat(data, stats->elapsed_time);
+}
+#endif
+
+// -- Returns the draw statistics as a string of little endian 32 bit integers: cells visited, tiles drawn, tiles
+// -- skipped as empty, tiles culled, context pushes and elapsed microseconds for the last draw, the same six
+// -- totals since resetStats(), the number of draws since then and the number of frame times that follow, oldest
+// -- first. Returns nil if the tilemap was built without TILEMAP_STATS_ENABLE.
+// function Tilemap:getStatsAsBytes()
+int tilemapGetStatsAsBytes(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+#ifdef TILEMAP_STATS_ENABLE
+    uint8_t data[(14 + TILEMAP_STATS_HISTORY) * 4];
+
+    uint8_t* current = tilemapPackStats(data, &this->stats);
+    current = tilemapPackStats(current, &this->total_stats);
+    current = tilemapPackStat(current, this->nb_of_draws);
+    current = tilemapPackStat(current, this->nb_of_frame_times);
+
+    int first_frame_time = this->nb_of_draws - this->nb_of_frame_times;
+    for (int i = 0; i < this->nb_of_frame_times; ++i) {
+        current = tilemapPackStat(current, this->frame_times[(first_frame_time + i) % TILEMAP_STATS_HISTORY]);
+    }
+
+    pd->lua->pushBytes((const char*)data, current - data);
+#else
+    pd->lua->pushNil();
+#endif
+
+    return 1;
+}
+
+// -- Clears the draw statistics totals and recent frame times.
+// function Tilemap:resetStats()
+int tilemapResetStats(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
         return 0;
     }
 
-    this->map = dmMemoryCalloc(this->width * this->height, sizeof(uint16_t));
+#ifdef TILEMAP_STATS_ENABLE
+    memset(&this->total_stats, 0, sizeof(TilemapStats));
+    this->nb_of_draws = 0;
+    this->nb_of_frame_times = 0;
+#endif
 
     return 0;
 }
 
+// -- Returns how sparse the map is and how many cells the last draw() could skip, as multiple values
+// -- (occupiedCells, totalCells, cellsInView, cellsVisited).
+// function Tilemap:getOccupancyStats()
+int tilemapGetOccupancyStats(lua_State* L)
+{
+    Tilemap* this = GET_TILEMAP_ARG(1);
+    if(this == NULL) {
+        DM_LOG("Tilemap: Error getting 'self' argument.");
+        return 0;
+    }
+
+    pd->lua->pushInt((this->map != NULL) ? this->map->nb_of_occupied_cells : 0);
+    pd->lua->pushInt(this->width * this->height);
+    pd->lua->pushInt(this->nb_of_cells_in_view);
+    pd->lua->pushInt(this->nb_of_cells_visited);
+
+    return 4;
+}
+
 // -- Returns the size of the tile map, in tiles, as a pair, (width, height).
 // function Tilemap:getSize()
 int tilemapGetSize(lua_State* L)
@@ -410,12 +3144,49 @@ static const lua_reg tilemapClass[] = {
     { "__gc", tilemapDelete },
     
     { "draw", tilemapDraw },
+    { "drawScaled", tilemapDrawScaled },
+    { "releaseScaledTiles", tilemapReleaseScaledTiles },
     { "setTileAtPosition", tilemapSetTileAtPosition },
     { "getTileAtPosition", tilemapGetTileAtPosition },
+    { "setTilesFromBytes", tilemapSetTilesFromBytes },
+    { "getTilesInRect", tilemapGetTilesInRect },
+    { "setTilesInRect", tilemapSetTilesInRect },
+    { "fillRect", tilemapFillRect },
+    { "copyRect", tilemapCopyRect },
     { "setSize", tilemapSetSize },
+    { "loadMap", tilemapLoadMap },
+    { "startLoadingMap", tilemapStartLoadingMap },
+    { "continueLoadingMap", tilemapContinueLoadingMap },
     { "getSize", tilemapGetSize },
     { "getPixelSize", tilemapGetPixelSize },
     { "getTileSize", tilemapGetTileSize },
+    { "setTileSolid", tilemapSetTileSolid },
+    { "setPassableTilesFromBytes", tilemapSetPassableTilesFromBytes },
+    { "overlapsRect", tilemapOverlapsRect },
+    { "getSolidRectsAsBytes", tilemapGetSolidRectsAsBytes },
+    { "moveAndCollide", tilemapMoveAndCollide },
+    { "raycast", tilemapRaycast },
+    { "lineOfSightFromBytes", tilemapLineOfSightFromBytes },
+    { "setTileCost", tilemapSetTileCost },
+    { "findPathAsBytes", tilemapFindPathAsBytes },
+    { "computeFlowField", tilemapComputeFlowField },
+    { "getFlowDirection", tilemapGetFlowDirection },
+    { "setAutotileRulesFromBytes", tilemapSetAutotileRulesFromBytes },
+    { "setTerrainAt", tilemapSetTerrainAt },
+    { "getTerrainAt", tilemapGetTerrainAt },
+    { "fillTerrainRect", tilemapFillTerrainRect },
+    { "setAnimation", tilemapSetAnimation },
+    { "setIncrementalDraw", tilemapSetIncrementalDraw },
+    { "setChunkCache", tilemapSetChunkCache },
+    { "getChunkCacheMemory", tilemapGetChunkCacheMemory },
+    { "setDirectDraw", tilemapSetDirectDraw },
+    { "setTileAtlas", tilemapSetTileAtlas },
+    { "getTileAtlasMemory", tilemapGetTileAtlasMemory },
+    { "getOverview", tilemapGetOverviewImage },
+    { "drawOverview", tilemapDrawOverview },
+    { "getOccupancyStats", tilemapGetOccupancyStats },
+    { "getStatsAsBytes", tilemapGetStatsAsBytes },
+    { "resetStats", tilemapResetStats },
     
     { NULL, NULL }
 };
@@ -7,6 +7,179 @@
 
 #include "pd_api.h"
 
+#include "Tilemap/Blitter.h"
+#include "Tilemap/Tileset.h"
+#include "Tilemap/TileStorage.h"
+#include "Tilemap/Collision.h"
+#include "Tilemap/Pathfinding.h"
+#include "Tilemap/Autotile.h"
+#include "Tilemap/MapFile.h"
+
+// -- Constants
+#define CLASSNAME_TILEMAP "dm.Tilemap"
+#define TILEMAP_MAX_DIRTY_CELLS 128
+#define TILEMAP_MAX_ANIMATIONS 32
+#define TILEMAP_STATS_HISTORY 32
+
+// -- Define TILEMAP_STATS_ENABLE, i.e. with UDEFS in the project's Makefile, to collect the draw statistics returned
+// -- by getStats(). Otherwise they are compiled out.
+#ifdef TILEMAP_STATS_ENABLE
+#define TILEMAP_STATS_ADD(this, name, amount)   ((this)->stats.name += (amount))
+#else
+#define TILEMAP_STATS_ADD(this, name, amount)
+#endif
+
+// -- A pre-rendered square of chunk_size x chunk_size tiles, linked in least-recently-used order when baked.
+// -- animated is set if the chunk was baked with animated tiles in it.
+typedef struct {
+    LCDBitmap* bitmap;
+    uint32_t last_used;
+    int animated;
+
+    int previous;
+    int next;
+} TilemapChunk;
+
+// -- Image base_index, 1-based, shown as the nb_of_frames images starting at base_index in turn.
+typedef struct {
+    int base_index;
+    int nb_of_frames;
+    int frame_duration;
+    int current_frame;
+} TilemapAnimation;
+
+// -- What a draw did and how long it took, in microseconds.
+typedef struct {
+    int nb_of_cells_visited;
+    int nb_of_tiles_drawn;
+    int nb_of_tiles_skipped;
+    int nb_of_tiles_culled;
+    int nb_of_context_pushes;
+    int elapsed_time;
+} TilemapStats;
+
+// -- Tilemap class
+typedef struct Tilemap Tilemap;
+
+typedef void (*TilemapDrawKernel)(Tilemap* this, uint8_t* frame, int x, int y, int left, int top, int right, int bottom);
+
+// -- A tilemap drawn above another one with its origin at screen coordinate (x, y).
+typedef struct {
+    const Tilemap* tilemap;
+
+    int x;
+    int y;
+} TilemapOccluder;
+
+struct Tilemap {
+    Tileset* tileset;
+
+    int height;
+    int width;
+
+    int tile_width;
+    int tile_height;
+
+    // -- The tileset's tiles, shared with every other tilemap using it.
+    int nb_of_tiles;
+    LCDBitmap** tiles;
+    uint8_t* tile_kinds;
+
+    // -- Arena the map, collision and path finding data are allocated in, or NULL to use the heap
+    Arena* arena;
+    LuaUDObject* arena_object;
+
+    TileStorage* map;
+
+    // -- Map file being loaded a few rows at a time by continueLoadingMap(), NULL when not loading
+    MapFileReader* loader;
+
+    // -- Solid cells, created the first time collisions are queried
+    Collision* collision;
+
+    // -- Tile costs and search buffers, created the first time they are set or a path is searched for
+    Pathfinding* pathfinding;
+
+    // -- Terrains painted with setTerrainAt() and the rules turning them into tiles, created when first needed
+    Autotile* autotile;
+
+    // -- Statistics for the last draw
+    int nb_of_cells_in_view;
+    int nb_of_cells_visited;
+
+#ifdef TILEMAP_STATS_ENABLE
+    // -- Statistics for the last draw, the totals since resetStats() and the time taken by the most recent draws
+    TilemapStats stats;
+    TilemapStats total_stats;
+    int nb_of_draws;
+    float draw_start_time;
+
+    int nb_of_frame_times;
+    int frame_times[TILEMAP_STATS_HISTORY];
+#endif
+
+    // -- Chunk cache state
+    int chunk_size;
+    int chunk_budget;
+    int chunks_wide;
+    int chunks_high;
+    TilemapChunk* chunks;
+
+    int chunk_memory;
+    int most_recent_chunk;
+    int least_recent_chunk;
+    uint32_t chunk_clock;
+
+    // -- Direct frame buffer drawing state
+    int direct_draw;
+    BlitterBitmap* tile_data;
+
+    // -- Packed and pre-shifted tiles used for direct drawing instead of tile_data when set
+    BlitterAtlas* atlas;
+
+    // -- Incremental drawing state
+    int incremental_draw;
+    int needs_full_redraw;
+    LCDColor background_color;
+
+    int last_draw_x;
+    int last_draw_y;
+
+    int nb_of_dirty_cells;
+    int dirty_cells[TILEMAP_MAX_DIRTY_CELLS];
+
+    // -- Animated tiles, displayed_tiles[index] is the index of the image currently shown for image index + 1
+    // -- and tile_animations[index] the 1-based index of its animation, or 0 if it is not animated.
+    int nb_of_animations;
+    TilemapAnimation animations[TILEMAP_MAX_ANIMATIONS];
+    uint16_t* displayed_tiles;
+    uint8_t* tile_animations;
+
+    // -- Downsampled view of the whole map, updated as cells change, and the coverage of each tile it is drawn with
+    LCDBitmap* overview;
+    int overview_scale;
+    const uint8_t* tile_coverages;
+
+    // -- Occlusion culling state
+    const TilemapOccluder* occluders;
+    int nb_of_occluders;
+
+    // -- Draw kernels selected for the current tile size
+    TilemapDrawKernel draw_tiles;
+    BlitterDrawFunction blit;
+};
+
 extern void register_Tilemap(PlaydateAPI*);
 
+extern void tilemapUpdateAnimations(Tilemap* this, int x, int y);
+extern void tilemapDrawRegion(Tilemap* this, int x, int y, int left, int top, int right, int bottom);
+
+#ifdef TILEMAP_STATS_ENABLE
+extern void tilemapStatsBeginDraw(Tilemap* this);
+extern void tilemapStatsEndDraw(Tilemap* this);
+#else
+#define tilemapStatsBeginDraw(this)
+#define tilemapStatsEndDraw(this)
+#endif
+
 #endif
@@ -0,0 +1,137 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#include "Tilemap/TilemapArena.h"
+#include "Tilemap/Arena.h"
+
+#define DM_LOG_ENABLE
+#include "pdbase/pdbase.h"
+
+// -- Forward declaration
+static const lua_reg tilemapArenaClass[];
+
+// -- Get an argument as a TilemapArena class
+#define GET_TILEMAPARENA_ARG(index)    pd->lua->getArgObject(index, CLASSNAME_TILEMAPARENA, NULL);
+
+// -- Register the class
+extern void register_TilemapArena(PlaydateAPI* api)
+{
+    const char* err = NULL;
+
+    // -- Register TilemapArena
+    if (!pd->lua->registerClass(CLASSNAME_TILEMAPARENA, tilemapArenaClass, NULL, 0, &err))
+    {
+        DM_LOG("dm.TilemapArena: Failed to register the TilemapArena class (%s).", err);
+        return;
+    }
+}
+
+// -- Allocate a new arena of size bytes, which tilemaps created with it allocate their maps, collision and path
+// -- finding data from.
+// function TilemapArena.new(size)
+int tilemapArenaNew(lua_State* L)
+{
+    int size = pd->lua->getArgInt(1);
+    if (size <= 0) {
+        DM_LOG("TilemapArena: Invalid size %d.", size);
+        return 0;
+    }
+
+    Arena* this = arenaNew((size_t)size);
+    if (this == NULL) {
+        return 0;
+    }
+
+    pd->lua->pushObject(this, CLASSNAME_TILEMAPARENA, 0);
+
+    return 1;
+}
+
+// -- Delete the arena. Tilemaps using it keep it alive so none are left by the time this is called.
+int tilemapArenaDelete(lua_State* L)
+{
+    Arena* this = GET_TILEMAPARENA_ARG(1);
+    if(this == NULL) {
+        DM_LOG("TilemapArena: Error getting 'self' argument.");
+        return 0;
+    }
+
+    arenaDelete(this);
+
+    return 0;
+}
+
+// -- Releases everything allocated in the arena at once. Tilemaps using it are left empty, as if their size had
+// -- never been set, and forget which tiles are solid and what their path finding costs are.
+// function TilemapArena:reset()
+int tilemapArenaReset(lua_State* L)
+{
+    Arena* this = GET_TILEMAPARENA_ARG(1);
+    if(this == NULL) {
+        DM_LOG("TilemapArena: Error getting 'self' argument.");
+        return 0;
+    }
+
+    arenaReset(this);
+
+    return 0;
+}
+
+// -- Returns the size of the arena in bytes.
+// function TilemapArena:getSize()
+int tilemapArenaGetSize(lua_State* L)
+{
+    Arena* this = GET_TILEMAPARENA_ARG(1);
+    if(this == NULL) {
+        DM_LOG("TilemapArena: Error getting 'self' argument.");
+        return 0;
+    }
+
+    pd->lua->pushInt((int)this->size);
+
+    return 1;
+}
+
+// -- Returns how many bytes of the arena are in use since it was last reset, including freed allocations waiting
+// -- to be reused.
+// function TilemapArena:getMemoryUsed()
+int tilemapArenaGetMemoryUsed(lua_State* L)
+{
+    Arena* this = GET_TILEMAPARENA_ARG(1);
+    if(this == NULL) {
+        DM_LOG("TilemapArena: Error getting 'self' argument.");
+        return 0;
+    }
+
+    pd->lua->pushInt((int)this->used);
+
+    return 1;
+}
+
+// -- Returns the most bytes the arena ever had in use, across resets, which is the size it needs to be.
+// function TilemapArena:getHighWaterMark()
+int tilemapArenaGetHighWaterMark(lua_State* L)
+{
+    Arena* this = GET_TILEMAPARENA_ARG(1);
+    if(this == NULL) {
+        DM_LOG("TilemapArena: Error getting 'self' argument.");
+        return 0;
+    }
+
+    pd->lua->pushInt((int)this->high_water_mark);
+
+    return 1;
+}
+
+static const lua_reg tilemapArenaClass[] = {
+    { "new", tilemapArenaNew },
+    { "__gc", tilemapArenaDelete },
+
+    { "reset", tilemapArenaReset },
+    { "getSize", tilemapArenaGetSize },
+    { "getMemoryUsed", tilemapArenaGetMemoryUsed },
+    { "getHighWaterMark", tilemapArenaGetHighWaterMark },
+
+    { NULL, NULL }
+};
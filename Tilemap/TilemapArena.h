@@ -0,0 +1,14 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef DM_TILEMAPARENA_H
+#define DM_TILEMAPARENA_H
+
+#include "pd_api.h"
+
+#define CLASSNAME_TILEMAPARENA "dm.TilemapArena"
+
+extern void register_TilemapArena(PlaydateAPI*);
+
+#endif
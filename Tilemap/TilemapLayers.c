@@ -0,0 +1,258 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#include "Tilemap/TilemapLayers.h"
+#include "Tilemap/Tilemap.h"
+
+#define DM_LOG_ENABLE
+#include "pdbase/pdbase.h"
+
+#include <math.h>
+
+// -- Forward declaration
+static const lua_reg tilemapLayersClass[];
+
+// -- Constants
+#define CLASSNAME_TILEMAPLAYERS "dm.TilemapLayers"
+#define TILEMAP_LAYERS_MAX_LAYERS 8
+
+// -- A dm.Tilemap drawn as one layer, kept alive for as long as it is part of the stack.
+typedef struct {
+    Tilemap* tilemap;
+    LuaUDObject* object;
+
+    float parallax_x;
+    float parallax_y;
+} TilemapLayer;
+
+// -- TilemapLayers class
+typedef struct {
+    int nb_of_layers;
+    TilemapLayer layers[TILEMAP_LAYERS_MAX_LAYERS];
+
+    // -- Screen origin of each layer for the current draw, layers above the one being drawn act as its occluders.
+    TilemapOccluder origins[TILEMAP_LAYERS_MAX_LAYERS];
+
+    int occlusion_culling;
+} TilemapLayers;
+
+// -- Get an argument as a TilemapLayers class
+#define GET_TILEMAPLAYERS_ARG(index)    pd->lua->getArgObject(index, CLASSNAME_TILEMAPLAYERS, NULL);
+
+// -- Register the class
+extern void register_TilemapLayers(PlaydateAPI* api)
+{
+    const char* err = NULL;
+
+    // -- Register TilemapLayers
+    if (!pd->lua->registerClass(CLASSNAME_TILEMAPLAYERS, tilemapLayersClass, NULL, 0, &err))
+    {
+        DM_LOG("dm.TilemapLayers: Failed to register the TilemapLayers class (%s).", err);
+        return;
+    }
+}
+
+// -- Allocate a new, empty, stack of layers
+int tilemapLayersNew(lua_State* L)
+{
+    TilemapLayers* this = dmMemoryCalloc(1, sizeof(TilemapLayers));
+    if (this == NULL) {
+        return 0;
+    }
+
+    this->nb_of_layers = 0;
+    this->occlusion_culling = 1;
+
+    pd->lua->pushObject(this, CLASSNAME_TILEMAPLAYERS, 0);
+
+    return 1;
+}
+
+// -- Delete the layers, releasing the tilemaps they reference
+int tilemapLayersDelete(lua_State* L)
+{
+    TilemapLayers* this = GET_TILEMAPLAYERS_ARG(1);
+    if(this == NULL) {
+        DM_LOG("TilemapLayers: Error getting 'self' argument.");
+        return 0;
+    }
+
+    for (int i = 0; i < this->nb_of_layers; ++i) {
+        pd->lua->releaseObject(this->layers[i].object);
+    }
+
+    dmMemoryFree(this);
+
+    return 0;
+}
+
+// -- Adds tilemap, a dm.Tilemap, on top of the existing layers. parallaxX and parallaxY (both default to 1.0)
+// -- scale the position passed to draw() for this layer, i.e. 0.5 scrolls at half speed. Returns the index of the
+// -- new layer.
+// function TilemapLayers:addLayer(tilemap, parallaxX, parallaxY)
+int tilemapLayersAddLayer(lua_State* L)
+{
+    TilemapLayers* this = GET_TILEMAPLAYERS_ARG(1);
+    if(this == NULL) {
+        DM_LOG("TilemapLayers: Error getting 'self' argument.");
+        return 0;
+    }
+
+    if (this->nb_of_layers == TILEMAP_LAYERS_MAX_LAYERS) {
+        DM_LOG("TilemapLayers: Can't add more than %d layers.", TILEMAP_LAYERS_MAX_LAYERS);
+        return 0;
+    }
+
+    LuaUDObject* object = NULL;
+    Tilemap* tilemap = pd->lua->getArgObject(2, CLASSNAME_TILEMAP, &object);
+    if (tilemap == NULL) {
+        DM_LOG("TilemapLayers: Error getting 'tilemap' argument.");
+        return 0;
+    }
+
+    TilemapLayer* layer = &this->layers[this->nb_of_layers];
+    layer->tilemap = tilemap;
+    layer->object = pd->lua->retainObject(object);
+    layer->parallax_x = pd->lua->argIsNil(3) ? 1.0f : pd->lua->getArgFloat(3);
+    layer->parallax_y = pd->lua->argIsNil(4) ? 1.0f : pd->lua->getArgFloat(4);
+
+    ++this->nb_of_layers;
+
+    pd->lua->pushInt(this->nb_of_layers);
+
+    return 1;
+}
+
+// -- Changes the parallax factors of the layer at (1-based) index.
+// function TilemapLayers:setLayerParallax(index, parallaxX, parallaxY)
+int tilemapLayersSetLayerParallax(lua_State* L)
+{
+    TilemapLayers* this = GET_TILEMAPLAYERS_ARG(1);
+    if(this == NULL) {
+        DM_LOG("TilemapLayers: Error getting 'self' argument.");
+        return 0;
+    }
+
+    int index = pd->lua->getArgInt(2);
+    if ((index < 1) || (index > this->nb_of_layers)) {
+        DM_LOG("TilemapLayers: Out of bounds layer index %d for setLayerParallax().", index);
+        return 0;
+    }
+
+    this->layers[index - 1].parallax_x = pd->lua->getArgFloat(3);
+    this->layers[index - 1].parallax_y = pd->lua->getArgFloat(4);
+
+    return 0;
+}
+
+// -- Returns the number of layers.
+// function TilemapLayers:getLayerCount()
+int tilemapLayersGetLayerCount(lua_State* L)
+{
+    TilemapLayers* this = GET_TILEMAPLAYERS_ARG(1);
+    if(this == NULL) {
+        DM_LOG("TilemapLayers: Error getting 'self' argument.");
+        return 0;
+    }
+
+    pd->lua->pushInt(this->nb_of_layers);
+
+    return 1;
+}
+
+// -- Enables or disables skipping tiles that are entirely hidden by opaque tiles in a layer above them. Enabled
+// -- by default.
+// function TilemapLayers:setOcclusionCulling(enabled)
+int tilemapLayersSetOcclusionCulling(lua_State* L)
+{
+    TilemapLayers* this = GET_TILEMAPLAYERS_ARG(1);
+    if(this == NULL) {
+        DM_LOG("TilemapLayers: Error getting 'self' argument.");
+        return 0;
+    }
+
+    this->occlusion_culling = pd->lua->getArgBool(2);
+
+    return 0;
+}
+
+// -- Draws all the layers, from the first one added to the last, with the origin of each one at screen coordinate
+// -- (x * parallaxX, y * parallaxY). Layers are always fully redrawn, even if incremental drawing is enabled on them.
+// function TilemapLayers:draw(x, y)
+int tilemapLayersDraw(lua_State* L)
+{
+    TilemapLayers* this = GET_TILEMAPLAYERS_ARG(1);
+    if(this == NULL) {
+        DM_LOG("TilemapLayers: Error getting 'self' argument.");
+        return 0;
+    }
+
+    float x = pd->lua->getArgFloat(2);
+    float y = pd->lua->getArgFloat(3);
+
+    for (int i = 0; i < this->nb_of_layers; ++i) {
+        this->origins[i].tilemap = this->layers[i].tilemap;
+        this->origins[i].x = (int)floorf(x * this->layers[i].parallax_x);
+        this->origins[i].y = (int)floorf(y * this->layers[i].parallax_y);
+
+        // -- Every layer shows its current frames before any is drawn, occlusion culling looks at the layers above.
+        if (this->layers[i].tilemap->map != NULL) {
+            tilemapUpdateAnimations(this->layers[i].tilemap, this->origins[i].x, this->origins[i].y);
+        }
+    }
+
+    int display_width = pd->display->getWidth();
+    int display_height = pd->display->getHeight();
+
+    pd->graphics->pushContext(NULL);
+    pd->graphics->setDrawOffset(0, 0);
+
+    for (int i = 0; i < this->nb_of_layers; ++i) {
+        Tilemap* tilemap = this->layers[i].tilemap;
+        if (tilemap->map == NULL) {
+            continue;
+        }
+
+        ++tilemap->chunk_clock;
+
+        tilemap->nb_of_cells_in_view = 0;
+        tilemap->nb_of_cells_visited = 0;
+
+        tilemapStatsBeginDraw(tilemap);
+        TILEMAP_STATS_ADD(tilemap, nb_of_context_pushes, 1);
+
+        int nb_of_occluders = this->nb_of_layers - (i + 1);
+        if (this->occlusion_culling && (nb_of_occluders > 0)) {
+            tilemap->occluders = &this->origins[i + 1];
+            tilemap->nb_of_occluders = nb_of_occluders;
+        }
+
+        tilemapDrawRegion(tilemap, this->origins[i].x, this->origins[i].y, 0, 0, display_width, display_height);
+
+        tilemap->occluders = NULL;
+        tilemap->nb_of_occluders = 0;
+
+        // -- The frame no longer matches what an incremental draw of this tilemap alone would expect.
+        tilemap->needs_full_redraw = 1;
+
+        tilemapStatsEndDraw(tilemap);
+    }
+
+    pd->graphics->popContext();
+
+    return 0;
+}
+
+static const lua_reg tilemapLayersClass[] = {
+    { "new", tilemapLayersNew },
+    { "__gc", tilemapLayersDelete },
+
+    { "addLayer", tilemapLayersAddLayer },
+    { "setLayerParallax", tilemapLayersSetLayerParallax },
+    { "getLayerCount", tilemapLayersGetLayerCount },
+    { "setOcclusionCulling", tilemapLayersSetOcclusionCulling },
+    { "draw", tilemapLayersDraw },
+
+    { NULL, NULL }
+};
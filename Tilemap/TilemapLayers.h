@@ -0,0 +1,12 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef DM_TILEMAPLAYERS_H
+#define DM_TILEMAPLAYERS_H
+
+#include "pd_api.h"
+
+extern void register_TilemapLayers(PlaydateAPI*);
+
+#endif
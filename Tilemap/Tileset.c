@@ -0,0 +1,434 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#include "Tilemap/Tileset.h"
+#include "Tilemap/TileStorage.h"
+
+#define DM_LOG_ENABLE
+#include "pdbase/pdbase.h"
+
+#include <string.h>
+
+// -- Every tileset currently loaded.
+static Tileset* tilesetCache = NULL;
+
+// -- 4x4 ordered dither thresholds, from 0 to TILESET_MAX_COVERAGE - 1.
+const uint8_t tilesetDitherThresholds[4][4] = {
+    { 0, 8, 2, 10 },
+    { 12, 4, 14, 6 },
+    { 3, 11, 1, 9 },
+    { 15, 7, 13, 5 }
+};
+
+// -- Work out from its pixels whether a tile can be skipped, filled with a solid color or drawn without its mask.
+static TilemapTileKind tilesetClassifyBitmap(LCDBitmap* bitmap)
+{
+    int width, height, rowbytes;
+    uint8_t* mask = NULL;
+    uint8_t* data = NULL;
+    pd->graphics->getBitmapData(bitmap, &width, &height, &rowbytes, &mask, &data);
+
+    int nb_of_bytes = (width + 7) / 8;
+    uint8_t last_byte_bits = ((width % 8) != 0) ? (uint8_t)(0xFF << (8 - (width % 8))) : 0xFF;
+
+    int has_visible_pixels = 0;
+    int has_hidden_pixels = 0;
+    int has_black_pixels = 0;
+    int has_white_pixels = 0;
+
+    for (int row = 0; row < height; ++row) {
+        const uint8_t* data_row = data + (row * rowbytes);
+        const uint8_t* mask_row = (mask != NULL) ? mask + (row * rowbytes) : NULL;
+
+        for (int i = 0; i < nb_of_bytes; ++i) {
+            uint8_t bits = (i == (nb_of_bytes - 1)) ? last_byte_bits : 0xFF;
+            uint8_t visible = (mask_row != NULL) ? (mask_row[i] & bits) : bits;
+
+            has_visible_pixels |= (visible != 0);
+            has_hidden_pixels |= (visible != bits);
+            has_white_pixels |= ((data_row[i] & visible) != 0);
+            has_black_pixels |= ((~data_row[i] & visible) != 0);
+        }
+    }
+
+    if (!has_visible_pixels) {
+        return kTilemapTileTransparent;
+    }
+
+    if (has_hidden_pixels) {
+        return kTilemapTileGeneral;
+    }
+
+    if (!has_white_pixels) {
+        return kTilemapTileBlack;
+    }
+
+    if (!has_black_pixels) {
+        return kTilemapTileWhite;
+    }
+
+    return kTilemapTileOpaque;
+}
+
+// -- Enumerate and classify every tile in the image table. Returns 0 if the table is empty or on error.
+static int tilesetSetupTiles(Tileset* this)
+{
+    int nb_of_tiles = 0;
+    while (pd->graphics->getTableBitmap(this->image_table, nb_of_tiles) != NULL) {
+        ++nb_of_tiles;
+    }
+
+    if (nb_of_tiles == 0) {
+        return 0;
+    }
+
+    if (nb_of_tiles > TILE_STORAGE_INDEX_MASK) {
+        DM_LOG("Tileset: Only the first %d of the %d images in '%s' can be used.", TILE_STORAGE_INDEX_MASK, nb_of_tiles, this->path);
+        nb_of_tiles = TILE_STORAGE_INDEX_MASK;
+    }
+
+    this->tiles = dmMemoryCalloc(nb_of_tiles, sizeof(LCDBitmap*));
+    this->tile_kinds = dmMemoryCalloc(nb_of_tiles, sizeof(uint8_t));
+    if ((this->tiles == NULL) || (this->tile_kinds == NULL)) {
+        DM_LOG("Tileset: Error allocating tile information for %d tiles.", nb_of_tiles);
+        return 0;
+    }
+
+    this->nb_of_tiles = nb_of_tiles;
+
+    for (int index = 0; index < nb_of_tiles; ++index) {
+        LCDBitmap* bitmap = pd->graphics->getTableBitmap(this->image_table, index);
+        TilemapTileKind kind = tilesetClassifyBitmap(bitmap);
+
+        this->tiles[index] = bitmap;
+        this->tile_kinds[index] = (uint8_t)kind;
+
+        uint8_t* mask = NULL;
+        int width, height;
+        pd->graphics->getBitmapData(bitmap, &width, &height, NULL, &mask, NULL);
+        if ((kind != kTilemapTileOpaque) || (mask == NULL)) {
+            continue;
+        }
+
+        // -- Opaque tiles stored with a mask are copied once so drawing them doesn't have to apply it.
+        LCDBitmap* copy = pd->graphics->newBitmap(width, height, kColorBlack);
+        if (copy == NULL) {
+            continue;
+        }
+
+        pd->graphics->pushContext(copy);
+        pd->graphics->setDrawOffset(0, 0);
+        pd->graphics->drawBitmap(bitmap, 0, 0, kBitmapUnflipped);
+        pd->graphics->popContext();
+
+        this->tiles[index] = copy;
+    }
+
+    // -- Bitmaps returned by getTableBitmap() belong to the table and must not be freed.
+    pd->graphics->getBitmapData(this->tiles[0], &this->tile_width, &this->tile_height, NULL, NULL, NULL);
+
+    return 1;
+}
+
+// -- Free the tileset and everything in it, including any copy made by tilesetSetupTiles().
+static void tilesetDelete(Tileset* this)
+{
+    if (this->tiles != NULL) {
+        for (int index = 0; index < this->nb_of_tiles; ++index) {
+            if (this->tiles[index] != pd->graphics->getTableBitmap(this->image_table, index)) {
+                pd->graphics->freeBitmap(this->tiles[index]);
+            }
+        }
+
+        dmMemoryFree(this->tiles);
+    }
+
+    dmMemoryFree(this->tile_kinds);
+    dmMemoryFree(this->tile_data);
+    dmMemoryFree(this->tile_coverages);
+
+    for (int scale = 0; scale < kTilesetNbOfScales; ++scale) {
+        tilesetReleaseScaledTiles(this, (TilesetScale)scale);
+    }
+
+    if (this->image_table != NULL) {
+        pd->graphics->freeBitmapTable(this->image_table);
+    }
+
+    dmMemoryFree(this->path);
+    dmMemoryFree(this);
+}
+
+// -- Return the tileset for the image table at path, loading it only if no other tilemap is using it already.
+// -- Every call must be matched with a call to tilesetRelease(). Returns NULL on error.
+Tileset* tilesetAcquire(const char* path)
+{
+    for (Tileset* tileset = tilesetCache; tileset != NULL; tileset = tileset->next) {
+        if (strcmp(tileset->path, path) == 0) {
+            ++tileset->nb_of_references;
+            return tileset;
+        }
+    }
+
+    Tileset* this = dmMemoryCalloc(1, sizeof(Tileset));
+    if (this == NULL) {
+        return NULL;
+    }
+
+    size_t path_length = strlen(path);
+    this->path = dmMemoryCalloc(path_length + 1, sizeof(char));
+    if (this->path == NULL) {
+        tilesetDelete(this);
+        return NULL;
+    }
+
+    memcpy(this->path, path, path_length);
+
+    const char* err = NULL;
+    this->image_table = pd->graphics->loadBitmapTable(path, &err);
+    if (this->image_table == NULL) {
+        DM_LOG("Tileset: Error loading image table '%s' (%s).", path, (err != NULL) ? err : "Unknown Error");
+        tilesetDelete(this);
+        return NULL;
+    }
+
+    if (!tilesetSetupTiles(this)) {
+        DM_LOG("Tileset: Error getting bitmaps from image table '%s'.", path);
+        tilesetDelete(this);
+        return NULL;
+    }
+
+    this->nb_of_references = 1;
+    this->next = tilesetCache;
+    tilesetCache = this;
+
+    return this;
+}
+
+// -- Stop using a tileset, which is freed once no tilemap uses it anymore.
+void tilesetRelease(Tileset* this)
+{
+    if (--this->nb_of_references > 0) {
+        return;
+    }
+
+    for (Tileset** current = &tilesetCache; *current != NULL; current = &(*current)->next) {
+        if (*current == this) {
+            *current = this->next;
+            break;
+        }
+    }
+
+    tilesetDelete(this);
+}
+
+// -- Return the pixel data of every tile so they can be blitted directly, fetching it the first time. Returns
+// -- NULL on error.
+BlitterBitmap* tilesetGetTileData(Tileset* this)
+{
+    if (this->tile_data != NULL) {
+        return this->tile_data;
+    }
+
+    this->tile_data = dmMemoryCalloc(this->nb_of_tiles, sizeof(BlitterBitmap));
+    if (this->tile_data == NULL) {
+        DM_LOG("Tileset: Error allocating tile data for %d tiles.", this->nb_of_tiles);
+        return NULL;
+    }
+
+    for (int index = 0; index < this->nb_of_tiles; ++index) {
+        blitterGetBitmap(this->tiles[index], &this->tile_data[index]);
+    }
+
+    return this->tile_data;
+}
+
+// -- Return how much of each tile is visible and black, working it out the first time. Returns NULL on error.
+const uint8_t* tilesetGetTileCoverages(Tileset* this)
+{
+    if (this->tile_coverages != NULL) {
+        return this->tile_coverages;
+    }
+
+    this->tile_coverages = dmMemoryCalloc(this->nb_of_tiles, sizeof(uint8_t));
+    if (this->tile_coverages == NULL) {
+        DM_LOG("Tileset: Error allocating tile coverages for %d tiles.", this->nb_of_tiles);
+        return NULL;
+    }
+
+    for (int index = 0; index < this->nb_of_tiles; ++index) {
+        int width, height, rowbytes;
+        uint8_t* mask = NULL;
+        uint8_t* data = NULL;
+        pd->graphics->getBitmapData(this->tiles[index], &width, &height, &rowbytes, &mask, &data);
+
+        int nb_of_black_pixels = 0;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                int offset = (y * rowbytes) + (x / 8);
+                uint8_t bit = (uint8_t)(0x80 >> (x % 8));
+                if (((mask == NULL) || (mask[offset] & bit)) && !(data[offset] & bit)) {
+                    ++nb_of_black_pixels;
+                }
+            }
+        }
+
+        int nb_of_pixels = width * height;
+        this->tile_coverages[index] = (uint8_t)(((nb_of_black_pixels * TILESET_MAX_COVERAGE) + (nb_of_pixels / 2)) / nb_of_pixels);
+    }
+
+    return this->tile_coverages;
+}
+
+// -- Return a copy of bitmap scaled by scale. Doubling repeats every pixel, shrinking keeps a pixel visible if at
+// -- least half the pixels it replaces are and dithers it to how many of those are white. Returns NULL on error.
+static LCDBitmap* tilesetScaleBitmap(LCDBitmap* bitmap, TilesetScale scale)
+{
+    int width, height, rowbytes;
+    uint8_t* mask = NULL;
+    uint8_t* data = NULL;
+    pd->graphics->getBitmapData(bitmap, &width, &height, &rowbytes, &mask, &data);
+
+    int factor = (scale == kTilesetScaleQuarter) ? 4 : 2;
+    int scaled_width = (scale == kTilesetScaleDouble) ? width * 2 : width / factor;
+    int scaled_height = (scale == kTilesetScaleDouble) ? height * 2 : height / factor;
+
+    // -- Bitmaps created clear have a mask, opaque ones keep drawing without one.
+    LCDBitmap* scaled = pd->graphics->newBitmap(scaled_width, scaled_height, (mask != NULL) ? kColorClear : kColorBlack);
+    if (scaled == NULL) {
+        return NULL;
+    }
+
+    int scaled_rowbytes;
+    uint8_t* scaled_mask = NULL;
+    uint8_t* scaled_data = NULL;
+    pd->graphics->getBitmapData(scaled, NULL, NULL, &scaled_rowbytes, &scaled_mask, &scaled_data);
+
+    for (int y = 0; y < scaled_height; ++y) {
+        for (int x = 0; x < scaled_width; ++x) {
+            int visible = 0;
+            int white = 0;
+
+            if (scale == kTilesetScaleDouble) {
+                int offset = ((y / 2) * rowbytes) + ((x / 2) / 8);
+                uint8_t bit = (uint8_t)(0x80 >> ((x / 2) % 8));
+
+                visible = (mask == NULL) || (mask[offset] & bit);
+                white = visible && (data[offset] & bit);
+            }
+            else {
+                int nb_of_visible_pixels = 0;
+                int nb_of_white_pixels = 0;
+
+                for (int source_y = y * factor; source_y < ((y + 1) * factor); ++source_y) {
+                    for (int source_x = x * factor; source_x < ((x + 1) * factor); ++source_x) {
+                        int offset = (source_y * rowbytes) + (source_x / 8);
+                        uint8_t bit = (uint8_t)(0x80 >> (source_x % 8));
+                        if ((mask == NULL) || (mask[offset] & bit)) {
+                            ++nb_of_visible_pixels;
+                            nb_of_white_pixels += ((data[offset] & bit) != 0);
+                        }
+                    }
+                }
+
+                visible = (nb_of_visible_pixels * 2) >= (factor * factor);
+                white = visible && (((nb_of_white_pixels * TILESET_MAX_COVERAGE) / nb_of_visible_pixels) > tilesetDitherThresholds[y & 3][x & 3]);
+            }
+
+            int offset = (y * scaled_rowbytes) + (x / 8);
+            uint8_t bit = (uint8_t)(0x80 >> (x % 8));
+
+            if (white) {
+                scaled_data[offset] |= bit;
+            }
+            else {
+                scaled_data[offset] &= (uint8_t)~bit;
+            }
+
+            if (scaled_mask != NULL) {
+                if (visible) {
+                    scaled_mask[offset] |= bit;
+                }
+                else {
+                    scaled_mask[offset] &= (uint8_t)~bit;
+                }
+            }
+        }
+    }
+
+    return scaled;
+}
+
+// -- Return every tile scaled by scale, making the copies the first time. Shrinking requires tile sizes that divide
+// -- evenly. Returns NULL on error.
+TilesetScaledTiles* tilesetGetScaledTiles(Tileset* this, TilesetScale scale)
+{
+    if (this->scaled_tiles[scale] != NULL) {
+        return this->scaled_tiles[scale];
+    }
+
+    int factor = (scale == kTilesetScaleQuarter) ? 4 : 2;
+    if ((scale != kTilesetScaleDouble) && (((this->tile_width % factor) != 0) || ((this->tile_height % factor) != 0))) {
+        DM_LOG("Tileset: Tiles of %dx%d pixels can't be shrunk to 1/%d.", this->tile_width, this->tile_height, factor);
+        return NULL;
+    }
+
+    TilesetScaledTiles* scaled_tiles = dmMemoryCalloc(1, sizeof(TilesetScaledTiles));
+    if (scaled_tiles == NULL) {
+        return NULL;
+    }
+
+    this->scaled_tiles[scale] = scaled_tiles;
+
+    scaled_tiles->tiles = dmMemoryCalloc(this->nb_of_tiles, sizeof(LCDBitmap*));
+    scaled_tiles->tile_kinds = dmMemoryCalloc(this->nb_of_tiles, sizeof(uint8_t));
+    scaled_tiles->tile_data = dmMemoryCalloc(this->nb_of_tiles, sizeof(BlitterBitmap));
+    if ((scaled_tiles->tiles == NULL) || (scaled_tiles->tile_kinds == NULL) || (scaled_tiles->tile_data == NULL)) {
+        DM_LOG("Tileset: Error allocating scaled tile information for %d tiles.", this->nb_of_tiles);
+        tilesetReleaseScaledTiles(this, scale);
+        return NULL;
+    }
+
+    for (int index = 0; index < this->nb_of_tiles; ++index) {
+        LCDBitmap* bitmap = tilesetScaleBitmap(this->tiles[index], scale);
+        if (bitmap == NULL) {
+            DM_LOG("Tileset: Error allocating scaled tile %d.", index + 1);
+            tilesetReleaseScaledTiles(this, scale);
+            return NULL;
+        }
+
+        scaled_tiles->tiles[index] = bitmap;
+        scaled_tiles->tile_kinds[index] = (uint8_t)tilesetClassifyBitmap(bitmap);
+        blitterGetBitmap(bitmap, &scaled_tiles->tile_data[index]);
+    }
+
+    pd->graphics->getBitmapData(scaled_tiles->tiles[0], &scaled_tiles->tile_width, &scaled_tiles->tile_height, NULL, NULL, NULL);
+
+    return scaled_tiles;
+}
+
+// -- Free the tiles scaled by scale, if they were made. They are made again the next time they are needed.
+void tilesetReleaseScaledTiles(Tileset* this, TilesetScale scale)
+{
+    TilesetScaledTiles* scaled_tiles = this->scaled_tiles[scale];
+    if (scaled_tiles == NULL) {
+        return;
+    }
+
+    if (scaled_tiles->tiles != NULL) {
+        for (int index = 0; index < this->nb_of_tiles; ++index) {
+            if (scaled_tiles->tiles[index] != NULL) {
+                pd->graphics->freeBitmap(scaled_tiles->tiles[index]);
+            }
+        }
+
+        dmMemoryFree(scaled_tiles->tiles);
+    }
+
+    dmMemoryFree(scaled_tiles->tile_kinds);
+    dmMemoryFree(scaled_tiles->tile_data);
+    dmMemoryFree(scaled_tiles);
+
+    this->scaled_tiles[scale] = NULL;
+}
@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef DM_TILESET_H
+#define DM_TILESET_H
+
+#include "pd_api.h"
+
+#include "Tilemap/Blitter.h"
+
+// -- How a tile can be drawn, worked out from its pixels when the tileset is loaded.
+typedef enum {
+    kTilemapTileGeneral,
+    kTilemapTileTransparent,
+    kTilemapTileOpaque,
+    kTilemapTileBlack,
+    kTilemapTileWhite
+} TilemapTileKind;
+
+// -- Darkest value a tile's coverage can have, for a tile whose pixels are all black.
+#define TILESET_MAX_COVERAGE    16
+
+// -- A pixel dithered to a coverage, or a share of white pixels, from 0 to TILESET_MAX_COVERAGE is set if that value
+// -- is above the threshold for its position.
+extern const uint8_t tilesetDitherThresholds[4][4];
+
+// -- Zoom levels tiles can be scaled to.
+typedef enum {
+    kTilesetScaleDouble,
+    kTilesetScaleHalf,
+    kTilesetScaleQuarter,
+    kTilesetNbOfScales
+} TilesetScale;
+
+// -- Copies of every tile scaled to one zoom level, in the same order as the tileset's tiles.
+typedef struct {
+    int tile_width;
+    int tile_height;
+
+    LCDBitmap** tiles;
+    uint8_t* tile_kinds;
+    BlitterBitmap* tile_data;
+} TilesetScaledTiles;
+
+// -- An image table and everything worked out from it, shared by all the tilemaps loaded from the same path.
+typedef struct Tileset {
+    char* path;
+    int nb_of_references;
+
+    LCDBitmapTable* image_table;
+
+    int tile_width;
+    int tile_height;
+
+    // -- tiles[index] is image index + 1, replaced by a copy without a mask if the image is fully opaque.
+    int nb_of_tiles;
+    LCDBitmap** tiles;
+    uint8_t* tile_kinds;
+
+    // -- Pixel data of every tile, fetched the first time it is needed.
+    BlitterBitmap* tile_data;
+
+    // -- tile_coverages[index] is how much of image index + 1 is visible and black, from 0 to TILESET_MAX_COVERAGE,
+    // -- worked out the first time it is needed.
+    uint8_t* tile_coverages;
+
+    // -- Scaled copies of the tiles for each TilesetScale, made the first time they are needed.
+    TilesetScaledTiles* scaled_tiles[kTilesetNbOfScales];
+
+    struct Tileset* next;
+} Tileset;
+
+extern Tileset* tilesetAcquire(const char* path);
+extern void tilesetRelease(Tileset* this);
+extern BlitterBitmap* tilesetGetTileData(Tileset* this);
+extern const uint8_t* tilesetGetTileCoverages(Tileset* this);
+extern TilesetScaledTiles* tilesetGetScaledTiles(Tileset* this, TilesetScale scale);
+extern void tilesetReleaseScaledTiles(Tileset* this, TilesetScale scale);
+
+#endif
@@ -0,0 +1,209 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+// -- Draws the same scripted scenarios with dm.Tilemap and dm.OldCTilemap, through drawBitmap() and drawing
+// -- directly into the frame buffer, against the stub Playdate API. Reports the host time per frame, the API calls
+// -- made per frame and a hash of every frame drawn. All the ways of drawing a scenario must produce the same
+// -- hash, the program exits with an error otherwise.
+
+#include "stub/Stub.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// -- Constants
+#define BENCHMARK_DEFAULT_NB_OF_FRAMES 200
+#define BENCHMARK_NB_OF_TILES 64
+#define BENCHMARK_TILE_SIZE 16
+
+// -- A scripted scenario. The camera moves by (speed_x, speed_y) pixels per frame, bouncing off the map's edges,
+// -- and nb_of_edits random cells are changed before each frame is drawn.
+typedef struct {
+    const char* name;
+
+    int width;
+    int height;
+    int fill_percentage;
+
+    int speed_x;
+    int speed_y;
+
+    int nb_of_edits;
+} BenchmarkScenario;
+
+// -- A class drawing a scenario and how it is set up.
+typedef struct {
+    const char* name;
+    const char* class_name;
+    int direct_draw;
+} BenchmarkTarget;
+
+static const BenchmarkScenario benchmarkScenarios[] = {
+    { "static", 100, 100, 60, 0, 0, 0 },
+    { "slow scroll", 200, 200, 60, 1, 1, 0 },
+    { "fast scroll", 200, 200, 60, 13, 7, 0 },
+    { "sparse", 200, 200, 5, 2, 1, 0 },
+    { "dense", 200, 200, 100, 2, 1, 0 },
+    { "heavy edits", 100, 100, 60, 0, 0, 64 }
+};
+
+static const BenchmarkTarget benchmarkTargets[] = {
+    { "Tilemap", "dm.Tilemap", 0 },
+    { "Tilemap direct", "dm.Tilemap", 1 },
+    { "OldCTilemap", "dm.OldCTilemap", 0 },
+    { "OldCTilemap direct", "dm.OldCTilemap", 1 }
+};
+
+#define BENCHMARK_NB_OF_SCENARIOS ((int)(sizeof(benchmarkScenarios) / sizeof(BenchmarkScenario)))
+#define BENCHMARK_NB_OF_TARGETS ((int)(sizeof(benchmarkTargets) / sizeof(BenchmarkTarget)))
+
+// -- Small deterministic random number generator, so every target sees the same map and edits.
+static uint32_t benchmarkRandom(uint32_t* state)
+{
+    *state = (*state * 1664525u) + 1013904223u;
+
+    return *state >> 8;
+}
+
+// -- A random tile index, or 0 for an empty cell if allow_empty is set. The first image is never used since
+// -- dm.OldCTilemap doesn't draw it, which would make its hashes differ.
+static int benchmarkRandomTile(uint32_t* state, int allow_empty)
+{
+    int value = (int)(benchmarkRandom(state) % (BENCHMARK_NB_OF_TILES - (allow_empty ? 0 : 1)));
+
+    return allow_empty ? ((value == 0) ? 0 : value + 1) : value + 2;
+}
+
+// -- Position of a camera moving by speed pixels per frame and bouncing between 0 and range.
+static int benchmarkCameraPosition(int frame, int speed, int range)
+{
+    if (range <= 0) {
+        return 0;
+    }
+
+    int position = (frame * speed) % (range * 2);
+
+    return (position > range) ? ((range * 2) - position) : position;
+}
+
+// -- Fill a new tilemap of class_name with the scenario's map.
+static void* benchmarkNewTilemap(const BenchmarkScenario* scenario, const BenchmarkTarget* target)
+{
+    void* tilemap = stubNew(target->class_name, "tiles");
+    if (tilemap == NULL) {
+        fprintf(stderr, "Benchmark: Error creating a %s.\n", target->class_name);
+        exit(1);
+    }
+
+    int nb_of_cells = scenario->width * scenario->height;
+    uint8_t* data = calloc(nb_of_cells, 2);
+    uint32_t state = 1234;
+
+    for (int cell = 0; cell < nb_of_cells; ++cell) {
+        if ((int)(benchmarkRandom(&state) % 100) < scenario->fill_percentage) {
+            data[cell * 2] = (uint8_t)benchmarkRandomTile(&state, 0);
+        }
+    }
+
+    stubArgObject(tilemap);
+    stubArgBytes(data, nb_of_cells * 2);
+    stubArgInt(scenario->width);
+    stubCall(target->class_name, "setTilesFromBytes");
+
+    free(data);
+
+    stubArgObject(tilemap);
+    stubArgBool(target->direct_draw);
+    stubCall(target->class_name, "setDirectDraw");
+
+    return tilemap;
+}
+
+// -- Draw nb_of_frames frames of the scenario with target and print what it cost. Returns the hash of every frame.
+static uint64_t benchmarkRun(const BenchmarkScenario* scenario, const BenchmarkTarget* target, int nb_of_frames)
+{
+    void* tilemap = benchmarkNewTilemap(scenario, target);
+
+    int range_x = (scenario->width * BENCHMARK_TILE_SIZE) - LCD_COLUMNS;
+    int range_y = (scenario->height * BENCHMARK_TILE_SIZE) - LCD_ROWS;
+
+    uint32_t state = 5678;
+    uint64_t hash = 0;
+    uint64_t total_time = 0;
+
+    stubResetCounters();
+
+    for (int frame = 0; frame < nb_of_frames; ++frame) {
+        stubClearFrame(kColorWhite);
+        stubSetMilliseconds((unsigned int)(frame * 33));
+
+        uint64_t start_time = stubGetTime();
+
+        for (int edit = 0; edit < scenario->nb_of_edits; ++edit) {
+            stubArgObject(tilemap);
+            stubArgInt(1 + (int)(benchmarkRandom(&state) % scenario->width));
+            stubArgInt(1 + (int)(benchmarkRandom(&state) % scenario->height));
+            stubArgInt(benchmarkRandomTile(&state, 1));
+            stubCall(target->class_name, "setTileAtPosition");
+        }
+
+        stubArgObject(tilemap);
+        stubArgInt(-benchmarkCameraPosition(frame, scenario->speed_x, range_x));
+        stubArgInt(-benchmarkCameraPosition(frame, scenario->speed_y, range_y));
+        stubCall(target->class_name, "draw");
+
+        total_time += stubGetTime() - start_time;
+
+        hash = stubHashFrame(hash);
+    }
+
+    printf("%-12s %-20s %12.0f %12.1f %12.1f %12.1f   %016" PRIx64 "\n", scenario->name, target->name,
+           (double)total_time / nb_of_frames,
+           (double)stubCounters.nb_of_draw_bitmap_calls / nb_of_frames,
+           (double)stubCounters.nb_of_table_bitmap_calls / nb_of_frames,
+           (double)stubCounters.nb_of_lua_arg_calls / nb_of_frames,
+           hash);
+
+    stubDelete(target->class_name, tilemap);
+
+    return hash;
+}
+
+int main(int argc, char** argv)
+{
+    int nb_of_frames = (argc > 1) ? atoi(argv[1]) : BENCHMARK_DEFAULT_NB_OF_FRAMES;
+    if (nb_of_frames <= 0) {
+        fprintf(stderr, "usage: %s [nb_of_frames]\n", argv[0]);
+        return 1;
+    }
+
+    stubSetTileset(BENCHMARK_NB_OF_TILES, BENCHMARK_TILE_SIZE, BENCHMARK_TILE_SIZE, 99);
+    stubInit();
+
+    printf("%-12s %-20s %12s %12s %12s %12s   %-16s\n", "scenario", "target", "ns/frame", "drawBitmap", "getTableBmp",
+           "Lua args", "hash");
+
+    int nb_of_mismatches = 0;
+
+    for (int scenario_index = 0; scenario_index < BENCHMARK_NB_OF_SCENARIOS; ++scenario_index) {
+        uint64_t expected_hash = 0;
+
+        for (int target_index = 0; target_index < BENCHMARK_NB_OF_TARGETS; ++target_index) {
+            uint64_t hash = benchmarkRun(&benchmarkScenarios[scenario_index], &benchmarkTargets[target_index], nb_of_frames);
+
+            if (target_index == 0) {
+                expected_hash = hash;
+            }
+            else if (hash != expected_hash) {
+                printf("MISMATCH: %s drew '%s' differently from %s.\n", benchmarkTargets[target_index].name,
+                       benchmarkScenarios[scenario_index].name, benchmarkTargets[0].name);
+                ++nb_of_mismatches;
+            }
+        }
+    }
+
+    return (nb_of_mismatches == 0) ? 0 : 1;
+}
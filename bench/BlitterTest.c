@@ -0,0 +1,284 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+// -- Compares blitterDraw(), the fixed size blitters, blitterDrawFlipped() and blitterAtlasDraw() against a reference
+// -- drawing one pixel at a time, for bitmaps of several sizes with and without a mask, at every pixel offset within
+// -- a frame buffer word and across the edges of the screen and of a clip rectangle.
+
+#include "Tilemap/Blitter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// -- Constants
+#define BLITTER_TEST_MAX_FAILURES 10
+#define BLITTER_TEST_NB_OF_BITMAPS 3
+
+typedef struct {
+    int width;
+    int height;
+} BlitterTestSize;
+
+typedef struct {
+    int left;
+    int top;
+    int right;
+    int bottom;
+} BlitterTestClip;
+
+static const BlitterTestSize blitterTestSizes[] = {
+    { 8, 8 }, { 16, 16 }, { 32, 32 }, { 13, 7 }, { 24, 5 }, { 33, 3 }, { 40, 9 }, { 70, 4 }
+};
+
+// -- The whole screen, a clip rectangle larger than it and one inside it with edges that aren't word aligned.
+static const BlitterTestClip blitterTestClips[] = {
+    { 0, 0, LCD_COLUMNS, LCD_ROWS },
+    { -20, -20, LCD_COLUMNS + 20, LCD_ROWS + 20 },
+    { 37, 21, 203, 111 }
+};
+
+#define BLITTER_TEST_NB_OF_SIZES ((int)(sizeof(blitterTestSizes) / sizeof(BlitterTestSize)))
+#define BLITTER_TEST_NB_OF_CLIPS ((int)(sizeof(blitterTestClips) / sizeof(BlitterTestClip)))
+
+static uint8_t blitterTestBackground[LCD_ROWS * LCD_ROWSIZE];
+static uint8_t blitterTestExpected[LCD_ROWS * LCD_ROWSIZE];
+static uint8_t blitterTestFrame[LCD_ROWS * LCD_ROWSIZE];
+
+static int blitterTestNbOfChecks = 0;
+static int blitterTestNbOfFailures = 0;
+
+static uint32_t blitterTestRandom(uint32_t* state)
+{
+    *state = (*state * 1664525u) + 1013904223u;
+
+    return *state >> 8;
+}
+
+static inline int blitterTestGetBit(const uint8_t* bits, int rowbytes, int x, int y)
+{
+    return (bits[(y * rowbytes) + (x >> 3)] >> (7 - (x & 7))) & 1;
+}
+
+// -- Make a bitmap of random pixels, with a random mask if masked is set. Rows are padded to a multiple of 4 bytes
+// -- like on the device and the padding is filled with garbage, which must never be drawn.
+static void blitterTestNewBitmap(BlitterBitmap* bitmap, int width, int height, int masked, uint32_t* state)
+{
+    int rowbytes = ((width + 31) / 32) * 4;
+
+    uint8_t* data = malloc(rowbytes * height);
+    uint8_t* mask = masked ? malloc(rowbytes * height) : NULL;
+
+    for (int i = 0; i < (rowbytes * height); ++i) {
+        data[i] = (uint8_t)blitterTestRandom(state);
+
+        if (mask != NULL) {
+            mask[i] = (uint8_t)(blitterTestRandom(state) | blitterTestRandom(state));
+        }
+    }
+
+    bitmap->data = data;
+    bitmap->mask = mask;
+    bitmap->rowbytes = rowbytes;
+    bitmap->width = width;
+    bitmap->height = height;
+}
+
+static void blitterTestFreeBitmap(BlitterBitmap* bitmap)
+{
+    free((void*)bitmap->data);
+    free((void*)bitmap->mask);
+}
+
+// -- Draw the bitmap into the expected frame one pixel at a time.
+static void blitterTestReferenceDraw(const BlitterBitmap* bitmap, int x, int y, LCDBitmapFlip flip, const BlitterTestClip* clip)
+{
+    int left = (clip->left > 0) ? clip->left : 0;
+    int top = (clip->top > 0) ? clip->top : 0;
+    int right = (clip->right < LCD_COLUMNS) ? clip->right : LCD_COLUMNS;
+    int bottom = (clip->bottom < LCD_ROWS) ? clip->bottom : LCD_ROWS;
+
+    int flip_x = (flip == kBitmapFlippedX) || (flip == kBitmapFlippedXY);
+    int flip_y = (flip == kBitmapFlippedY) || (flip == kBitmapFlippedXY);
+
+    for (int draw_y = 0; draw_y < bitmap->height; ++draw_y) {
+        int frame_y = y + draw_y;
+        if ((frame_y < top) || (frame_y >= bottom)) {
+            continue;
+        }
+
+        int source_y = flip_y ? (bitmap->height - 1 - draw_y) : draw_y;
+
+        for (int draw_x = 0; draw_x < bitmap->width; ++draw_x) {
+            int frame_x = x + draw_x;
+            if ((frame_x < left) || (frame_x >= right)) {
+                continue;
+            }
+
+            int source_x = flip_x ? (bitmap->width - 1 - draw_x) : draw_x;
+            if ((bitmap->mask != NULL) && !blitterTestGetBit(bitmap->mask, bitmap->rowbytes, source_x, source_y)) {
+                continue;
+            }
+
+            uint8_t* byte = &blitterTestExpected[(frame_y * LCD_ROWSIZE) + (frame_x >> 3)];
+            uint8_t bit = (uint8_t)(0x80 >> (frame_x & 7));
+
+            if (blitterTestGetBit(bitmap->data, bitmap->rowbytes, source_x, source_y)) {
+                *byte |= bit;
+            }
+            else {
+                *byte &= (uint8_t)~bit;
+            }
+        }
+    }
+}
+
+// -- Compare the frame drawn by name with the expected one and report the first pixel that differs.
+static void blitterTestCheck(const char* name, const BlitterBitmap* bitmap, int x, int y, LCDBitmapFlip flip, const BlitterTestClip* clip)
+{
+    ++blitterTestNbOfChecks;
+
+    if (memcmp(blitterTestFrame, blitterTestExpected, sizeof(blitterTestFrame)) == 0) {
+        return;
+    }
+
+    if (++blitterTestNbOfFailures > BLITTER_TEST_MAX_FAILURES) {
+        return;
+    }
+
+    for (int i = 0; i < (int)sizeof(blitterTestFrame); ++i) {
+        if (blitterTestFrame[i] != blitterTestExpected[i]) {
+            printf("FAIL: %s %dx%d%s flip %d at (%d, %d) clipped to (%d, %d, %d, %d): pixels (%d, %d) are %02x instead of %02x.\n",
+                   name, bitmap->width, bitmap->height, (bitmap->mask != NULL) ? " masked" : "", (int)flip, x, y,
+                   clip->left, clip->top, clip->right, clip->bottom, (i % LCD_ROWSIZE) * 8, i / LCD_ROWSIZE,
+                   blitterTestFrame[i], blitterTestExpected[i]);
+            return;
+        }
+    }
+}
+
+static void blitterTestStart(const BlitterBitmap* bitmap, int x, int y, LCDBitmapFlip flip, const BlitterTestClip* clip)
+{
+    memcpy(blitterTestFrame, blitterTestBackground, sizeof(blitterTestFrame));
+    memcpy(blitterTestExpected, blitterTestBackground, sizeof(blitterTestExpected));
+
+    blitterTestReferenceDraw(bitmap, x, y, flip, clip);
+}
+
+// -- Draw bitmaps[0] at (x, y) with every blitter that supports it.
+static void blitterTestDrawAt(const BlitterBitmap* bitmaps, BlitterAtlas* atlas, BlitterAtlas* unshifted_atlas, int x, int y,
+                              const BlitterTestClip* clip)
+{
+    const BlitterBitmap* bitmap = &bitmaps[0];
+    int left = clip->left;
+    int top = clip->top;
+    int right = clip->right;
+    int bottom = clip->bottom;
+
+    blitterTestStart(bitmap, x, y, kBitmapUnflipped, clip);
+    blitterDraw(blitterTestFrame, bitmap, x, y, left, top, right, bottom);
+    blitterTestCheck("blitterDraw", bitmap, x, y, kBitmapUnflipped, clip);
+
+    BlitterDrawFunction draw = blitterGetDrawFunction(bitmap->width, bitmap->height, bitmap->mask != NULL);
+    if (draw != blitterDraw) {
+        blitterTestStart(bitmap, x, y, kBitmapUnflipped, clip);
+        draw(blitterTestFrame, bitmap, x, y, left, top, right, bottom);
+        blitterTestCheck("blitterGetDrawFunction", bitmap, x, y, kBitmapUnflipped, clip);
+    }
+
+    for (int flip = kBitmapUnflipped; flip <= kBitmapFlippedXY; ++flip) {
+        blitterTestStart(bitmap, x, y, (LCDBitmapFlip)flip, clip);
+        blitterDrawFlipped(blitterTestFrame, bitmap, x, y, (LCDBitmapFlip)flip, left, top, right, bottom);
+        blitterTestCheck("blitterDrawFlipped", bitmap, x, y, (LCDBitmapFlip)flip, clip);
+    }
+
+    if (atlas != NULL) {
+        blitterTestStart(bitmap, x, y, kBitmapUnflipped, clip);
+        blitterAtlasDraw(atlas, blitterTestFrame, 0, x, y, left, top, right, bottom);
+        blitterTestCheck("blitterAtlasDraw", bitmap, x, y, kBitmapUnflipped, clip);
+
+        blitterTestStart(bitmap, x, y, kBitmapUnflipped, clip);
+        blitterAtlasDraw(unshifted_atlas, blitterTestFrame, 0, x, y, left, top, right, bottom);
+        blitterTestCheck("blitterAtlasDraw over budget", bitmap, x, y, kBitmapUnflipped, clip);
+    }
+}
+
+// -- Draw bitmaps[0] at every offset within a word, and across the edges of the screen and of the clip rectangle.
+static void blitterTestBitmap(const BlitterBitmap* bitmaps)
+{
+    const BlitterBitmap* bitmap = &bitmaps[0];
+
+    // -- Atlases are made of several bitmaps so that drawing index 0 checks they are kept apart. One of them gets no
+    // -- budget for shifted copies and always takes the slow path.
+    BlitterAtlas* atlas = NULL;
+    BlitterAtlas* unshifted_atlas = NULL;
+    if (bitmap->width <= 32) {
+        atlas = blitterAtlasNew(bitmaps, BLITTER_TEST_NB_OF_BITMAPS, 1024 * 1024);
+        unshifted_atlas = blitterAtlasNew(bitmaps, BLITTER_TEST_NB_OF_BITMAPS, 0);
+    }
+
+    int width = bitmap->width;
+    int height = bitmap->height;
+
+    for (int clip_index = 0; clip_index < BLITTER_TEST_NB_OF_CLIPS; ++clip_index) {
+        const BlitterTestClip* clip = &blitterTestClips[clip_index];
+
+        int x_bases[] = { 96, -width, 0, clip->left - width, clip->left, clip->right - width, clip->right,
+                          LCD_COLUMNS - width, LCD_COLUMNS };
+        int ys[] = { 50, -height, -height + 1, -1, 0, clip->top - 1, clip->bottom - height + 1, LCD_ROWS - height,
+                     LCD_ROWS - 1, LCD_ROWS };
+
+        for (int y_index = 0; y_index < (int)(sizeof(ys) / sizeof(int)); ++y_index) {
+            for (int base_index = 0; base_index < (int)(sizeof(x_bases) / sizeof(int)); ++base_index) {
+                // -- The first base walks every offset within a word, the others a few pixels around an edge.
+                int first = (base_index == 0) ? 0 : -2;
+                int last = (base_index == 0) ? 31 : 2;
+
+                for (int offset = first; offset <= last; ++offset) {
+                    blitterTestDrawAt(bitmaps, atlas, unshifted_atlas, x_bases[base_index] + offset, ys[y_index], clip);
+                }
+            }
+        }
+    }
+
+    if (atlas != NULL) {
+        blitterAtlasDelete(atlas);
+        blitterAtlasDelete(unshifted_atlas);
+    }
+}
+
+int main(void)
+{
+    uint32_t state = 42;
+
+    for (int i = 0; i < (int)sizeof(blitterTestBackground); ++i) {
+        blitterTestBackground[i] = (uint8_t)blitterTestRandom(&state);
+    }
+
+    for (int size_index = 0; size_index < BLITTER_TEST_NB_OF_SIZES; ++size_index) {
+        for (int masked = 0; masked < 2; ++masked) {
+            BlitterBitmap bitmaps[BLITTER_TEST_NB_OF_BITMAPS];
+
+            for (int index = 0; index < BLITTER_TEST_NB_OF_BITMAPS; ++index) {
+                blitterTestNewBitmap(&bitmaps[index], blitterTestSizes[size_index].width, blitterTestSizes[size_index].height,
+                                     masked, &state);
+            }
+
+            blitterTestBitmap(bitmaps);
+
+            for (int index = 0; index < BLITTER_TEST_NB_OF_BITMAPS; ++index) {
+                blitterTestFreeBitmap(&bitmaps[index]);
+            }
+        }
+    }
+
+    if (blitterTestNbOfFailures != 0) {
+        printf("BlitterTest: %d of %d draws differ from the reference.\n", blitterTestNbOfFailures, blitterTestNbOfChecks);
+        return 1;
+    }
+
+    printf("BlitterTest: %d draws match the reference.\n", blitterTestNbOfChecks);
+
+    return 0;
+}
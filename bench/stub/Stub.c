@@ -0,0 +1,822 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#include "Stub.h"
+
+#include "Tilemap/Tilemap.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// -- Constants
+#define STUB_MAX_CLASSES 8
+#define STUB_MAX_ARGS 16
+#define STUB_MAX_RESULTS 16
+#define STUB_MAX_CONTEXTS 16
+#define STUB_MAX_TILES 256
+
+struct LCDBitmapTable {
+    int nb_of_bitmaps;
+    LCDBitmap* bitmaps[STUB_MAX_TILES];
+};
+
+// -- A graphics context, pushed with pushContext(). target is NULL for the frame buffer.
+typedef struct {
+    LCDBitmap* target;
+
+    int offset_x;
+    int offset_y;
+
+    int clip_left;
+    int clip_top;
+    int clip_right;
+    int clip_bottom;
+} StubContext;
+
+typedef struct {
+    const char* name;
+    const lua_reg* methods;
+} StubClass;
+
+StubCounters stubCounters;
+uint8_t stubFrame[LCD_ROWS * LCD_ROWSIZE];
+
+static StubContext stubContexts[STUB_MAX_CONTEXTS];
+static int stubCurrentContext = 0;
+
+static LCDBitmapTable stubTable;
+static unsigned int stubMilliseconds = 0;
+static uint64_t stubStartTime = 0;
+
+static StubClass stubClasses[STUB_MAX_CLASSES];
+static int stubNbOfClasses = 0;
+
+static StubValue stubArgs[STUB_MAX_ARGS];
+static int stubNbOfArgs = 0;
+static StubValue stubResults[STUB_MAX_RESULTS];
+static int stubNbOfResults = 0;
+
+uint64_t stubGetTime(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t)now.tv_sec * 1000000000u) + (uint64_t)now.tv_nsec;
+}
+
+// -- Bitmaps
+
+LCDBitmap* stubNewBitmap(int width, int height, LCDColor color)
+{
+    LCDBitmap* bitmap = calloc(1, sizeof(LCDBitmap));
+    bitmap->width = width;
+    bitmap->height = height;
+    bitmap->rowbytes = ((width + 31) / 32) * 4;
+    bitmap->data = calloc(bitmap->rowbytes, height);
+
+    if (color == kColorClear) {
+        bitmap->mask = calloc(bitmap->rowbytes, height);
+    }
+    else if (color == kColorWhite) {
+        memset(bitmap->data, 0xFF, bitmap->rowbytes * height);
+    }
+
+    return bitmap;
+}
+
+static void stubReleaseBitmap(LCDBitmap* bitmap)
+{
+    free(bitmap->data);
+    free(bitmap->mask);
+    free(bitmap);
+}
+
+void stubFreeBitmap(LCDBitmap* bitmap)
+{
+    if ((bitmap == NULL) || bitmap->owned_by_table) {
+        return;
+    }
+
+    stubReleaseBitmap(bitmap);
+}
+
+static inline int stubGetBit(const uint8_t* bits, int rowbytes, int x, int y)
+{
+    return (bits[(y * rowbytes) + (x >> 3)] >> (7 - (x & 7))) & 1;
+}
+
+// -- Set pixel (x, y) of the current context's target to white, black or, if color is kColorClear, transparent.
+static void stubSetPixel(int x, int y, LCDColor color)
+{
+    StubContext* context = &stubContexts[stubCurrentContext];
+    if ((x < context->clip_left) || (x >= context->clip_right) || (y < context->clip_top) || (y >= context->clip_bottom)) {
+        return;
+    }
+
+    LCDBitmap* target = context->target;
+    int width = (target != NULL) ? target->width : LCD_COLUMNS;
+    int height = (target != NULL) ? target->height : LCD_ROWS;
+    if ((x < 0) || (y < 0) || (x >= width) || (y >= height)) {
+        return;
+    }
+
+    uint8_t* data = (target != NULL) ? target->data : stubFrame;
+    uint8_t* mask = (target != NULL) ? target->mask : NULL;
+    int offset = (y * ((target != NULL) ? target->rowbytes : LCD_ROWSIZE)) + (x >> 3);
+    uint8_t bit = 0x80 >> (x & 7);
+
+    if (color == kColorClear) {
+        if (mask != NULL) {
+            mask[offset] &= ~bit;
+        }
+
+        return;
+    }
+
+    if (color == kColorWhite) {
+        data[offset] |= bit;
+    }
+    else {
+        data[offset] &= ~bit;
+    }
+
+    if (mask != NULL) {
+        mask[offset] |= bit;
+    }
+}
+
+// -- Graphics
+
+static void stubSetDrawOffset(int dx, int dy)
+{
+    stubContexts[stubCurrentContext].offset_x = dx;
+    stubContexts[stubCurrentContext].offset_y = dy;
+}
+
+static void stubClearClipRect(void)
+{
+    StubContext* context = &stubContexts[stubCurrentContext];
+    context->clip_left = -1000000;
+    context->clip_top = -1000000;
+    context->clip_right = 1000000;
+    context->clip_bottom = 1000000;
+}
+
+// -- Like on device, the clip rect is moved by the current draw offset.
+static void stubSetClipRect(int x, int y, int width, int height)
+{
+    StubContext* context = &stubContexts[stubCurrentContext];
+    context->clip_left = x + context->offset_x;
+    context->clip_top = y + context->offset_y;
+    context->clip_right = context->clip_left + width;
+    context->clip_bottom = context->clip_top + height;
+}
+
+static void stubPushContext(LCDBitmap* target)
+{
+    if (stubCurrentContext == (STUB_MAX_CONTEXTS - 1)) {
+        fprintf(stderr, "Stub: Too many pushed contexts.\n");
+        exit(1);
+    }
+
+    StubContext* context = &stubContexts[++stubCurrentContext];
+    context->target = target;
+    context->offset_x = 0;
+    context->offset_y = 0;
+    stubClearClipRect();
+}
+
+static void stubPopContext(void)
+{
+    if (stubCurrentContext > 0) {
+        --stubCurrentContext;
+    }
+}
+
+static void stubDrawBitmap(LCDBitmap* bitmap, int x, int y, LCDBitmapFlip flip)
+{
+    uint64_t start_time = stubGetTime();
+
+    const StubContext* context = &stubContexts[stubCurrentContext];
+    x += context->offset_x;
+    y += context->offset_y;
+
+    for (int row = 0; row < bitmap->height; ++row) {
+        int source_y = (flip & kBitmapFlippedY) ? (bitmap->height - 1 - row) : row;
+
+        for (int column = 0; column < bitmap->width; ++column) {
+            int source_x = (flip & kBitmapFlippedX) ? (bitmap->width - 1 - column) : column;
+
+            if ((bitmap->mask != NULL) && !stubGetBit(bitmap->mask, bitmap->rowbytes, source_x, source_y)) {
+                continue;
+            }
+
+            stubSetPixel(x + column, y + row,
+                         stubGetBit(bitmap->data, bitmap->rowbytes, source_x, source_y) ? kColorWhite : kColorBlack);
+        }
+    }
+
+    ++stubCounters.nb_of_draw_bitmap_calls;
+    stubCounters.draw_bitmap_time += stubGetTime() - start_time;
+}
+
+static void stubFillRect(int x, int y, int width, int height, LCDColor color)
+{
+    const StubContext* context = &stubContexts[stubCurrentContext];
+    x += context->offset_x;
+    y += context->offset_y;
+
+    for (int row = y; row < (y + height); ++row) {
+        for (int column = x; column < (x + width); ++column) {
+            stubSetPixel(column, row, color);
+        }
+    }
+
+    ++stubCounters.nb_of_fill_rect_calls;
+}
+
+static LCDBitmap* stubCopyBitmap(LCDBitmap* bitmap)
+{
+    LCDBitmap* copy = stubNewBitmap(bitmap->width, bitmap->height, kColorBlack);
+    memcpy(copy->data, bitmap->data, bitmap->rowbytes * bitmap->height);
+
+    if (bitmap->mask != NULL) {
+        copy->mask = malloc(bitmap->rowbytes * bitmap->height);
+        memcpy(copy->mask, bitmap->mask, bitmap->rowbytes * bitmap->height);
+    }
+
+    return copy;
+}
+
+static void stubGetBitmapData(LCDBitmap* bitmap, int* width, int* height, int* rowbytes, uint8_t** mask, uint8_t** data)
+{
+    if (width != NULL) {
+        *width = bitmap->width;
+    }
+
+    if (height != NULL) {
+        *height = bitmap->height;
+    }
+
+    if (rowbytes != NULL) {
+        *rowbytes = bitmap->rowbytes;
+    }
+
+    if (mask != NULL) {
+        *mask = bitmap->mask;
+    }
+
+    if (data != NULL) {
+        *data = bitmap->data;
+    }
+}
+
+// -- Every path loads the tileset set up with stubSetTileset().
+static LCDBitmapTable* stubLoadBitmapTable(const char* path, const char** outerr)
+{
+    (void)path;
+
+    if (stubTable.nb_of_bitmaps == 0) {
+        *outerr = "no tileset set up";
+        return NULL;
+    }
+
+    return &stubTable;
+}
+
+static void stubFreeBitmapTable(LCDBitmapTable* table)
+{
+    (void)table;
+}
+
+static LCDBitmap* stubGetTableBitmap(LCDBitmapTable* table, int index)
+{
+    uint64_t start_time = stubGetTime();
+
+    LCDBitmap* bitmap = ((index >= 0) && (index < table->nb_of_bitmaps)) ? table->bitmaps[index] : NULL;
+
+    ++stubCounters.nb_of_table_bitmap_calls;
+    stubCounters.table_bitmap_time += stubGetTime() - start_time;
+
+    return bitmap;
+}
+
+static uint8_t* stubGetFrame(void)
+{
+    return stubFrame;
+}
+
+static void stubMarkUpdatedRows(int start, int end)
+{
+    (void)start;
+    (void)end;
+}
+
+static int stubGetDisplayWidth(void)
+{
+    return LCD_COLUMNS;
+}
+
+static int stubGetDisplayHeight(void)
+{
+    return LCD_ROWS;
+}
+
+// -- System
+
+static void* stubRealloc(void* pointer, size_t size)
+{
+    if (size == 0) {
+        free(pointer);
+        return NULL;
+    }
+
+    return realloc(pointer, size);
+}
+
+static void stubLogToConsole(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+
+    fputc('\n', stderr);
+}
+
+static unsigned int stubGetCurrentTimeMilliseconds(void)
+{
+    return stubMilliseconds;
+}
+
+static float stubGetElapsedTime(void)
+{
+    return (float)((double)(stubGetTime() - stubStartTime) / 1000000000.0);
+}
+
+// -- Files, read straight from the host's file system.
+
+static const char* stubGetFileError(void)
+{
+    return "file error";
+}
+
+static SDFile* stubOpenFile(const char* name, FileOptions mode)
+{
+    return (SDFile*)fopen(name, (mode & kFileWrite) ? "wb" : "rb");
+}
+
+static int stubCloseFile(SDFile* file)
+{
+    return fclose((FILE*)file);
+}
+
+static int stubReadFile(SDFile* file, void* buffer, unsigned int length)
+{
+    return (int)fread(buffer, 1, length, (FILE*)file);
+}
+
+// -- Lua
+
+static int stubRegisterClass(const char* name, const lua_reg* reg, const lua_val* vals, int isstatic, const char** outErr)
+{
+    (void)vals;
+    (void)isstatic;
+
+    if (stubNbOfClasses == STUB_MAX_CLASSES) {
+        *outErr = "too many classes";
+        return 0;
+    }
+
+    stubClasses[stubNbOfClasses].name = name;
+    stubClasses[stubNbOfClasses].methods = reg;
+    ++stubNbOfClasses;
+
+    return 1;
+}
+
+// -- Return argument pos, 1-based, counting the call, or NULL if there aren't that many.
+static const StubValue* stubGetArg(int pos, uint64_t start_time)
+{
+    ++stubCounters.nb_of_lua_arg_calls;
+    const StubValue* arg = ((pos >= 1) && (pos <= stubNbOfArgs) && (stubArgs[pos - 1].type != kTypeNil)) ? &stubArgs[pos - 1] : NULL;
+    stubCounters.lua_arg_time += stubGetTime() - start_time;
+
+    return arg;
+}
+
+static int stubArgIsNil(int pos)
+{
+    return stubGetArg(pos, stubGetTime()) == NULL;
+}
+
+static int stubGetArgBool(int pos)
+{
+    const StubValue* arg = stubGetArg(pos, stubGetTime());
+    return (arg != NULL) ? arg->int_value : 0;
+}
+
+static int stubGetArgInt(int pos)
+{
+    const StubValue* arg = stubGetArg(pos, stubGetTime());
+    if (arg == NULL) {
+        return 0;
+    }
+
+    return (arg->type == kTypeFloat) ? (int)arg->float_value : arg->int_value;
+}
+
+static float stubGetArgFloat(int pos)
+{
+    const StubValue* arg = stubGetArg(pos, stubGetTime());
+    if (arg == NULL) {
+        return 0.0f;
+    }
+
+    return (arg->type == kTypeInt) ? (float)arg->int_value : arg->float_value;
+}
+
+static const char* stubGetArgString(int pos)
+{
+    const StubValue* arg = stubGetArg(pos, stubGetTime());
+    return ((arg != NULL) && (arg->type == kTypeString)) ? arg->bytes : NULL;
+}
+
+static const char* stubGetArgBytes(int pos, size_t* outlen)
+{
+    const StubValue* arg = stubGetArg(pos, stubGetTime());
+    if ((arg == NULL) || (arg->type != kTypeString)) {
+        return NULL;
+    }
+
+    *outlen = arg->length;
+
+    return arg->bytes;
+}
+
+static void* stubGetArgObject(int pos, char* type, LuaUDObject** outud)
+{
+    (void)type;
+
+    const StubValue* arg = stubGetArg(pos, stubGetTime());
+    void* object = ((arg != NULL) && (arg->type == kTypeObject)) ? arg->object : NULL;
+
+    if (outud != NULL) {
+        *outud = (LuaUDObject*)object;
+    }
+
+    return object;
+}
+
+static StubValue* stubPushResult(LuaType type)
+{
+    if (stubNbOfResults == STUB_MAX_RESULTS) {
+        fprintf(stderr, "Stub: Too many results.\n");
+        exit(1);
+    }
+
+    StubValue* result = &stubResults[stubNbOfResults++];
+    memset(result, 0, sizeof(StubValue));
+    result->type = type;
+
+    return result;
+}
+
+static void stubPushNil(void)
+{
+    stubPushResult(kTypeNil);
+}
+
+static void stubPushBool(int value)
+{
+    stubPushResult(kTypeBool)->int_value = value;
+}
+
+static void stubPushInt(int value)
+{
+    stubPushResult(kTypeInt)->int_value = value;
+}
+
+static void stubPushFloat(float value)
+{
+    stubPushResult(kTypeFloat)->float_value = value;
+}
+
+static void stubPushBytes(const char* bytes, size_t length)
+{
+    char* copy = malloc(length + 1);
+    memcpy(copy, bytes, length);
+    copy[length] = 0;
+
+    StubValue* result = stubPushResult(kTypeString);
+    result->bytes = copy;
+    result->length = length;
+}
+
+static void stubPushBitmap(LCDBitmap* bitmap)
+{
+    StubValue* result = stubPushResult(kTypeObject);
+    result->object = bitmap;
+    result->bitmap = bitmap;
+}
+
+static LuaUDObject* stubPushObject(void* object, char* type, int nValues)
+{
+    (void)type;
+    (void)nValues;
+
+    stubPushResult(kTypeObject)->object = object;
+
+    return (LuaUDObject*)object;
+}
+
+static LuaUDObject* stubRetainObject(LuaUDObject* object)
+{
+    return object;
+}
+
+static void stubReleaseObject(LuaUDObject* object)
+{
+    (void)object;
+}
+
+static void stubFreeResults(void)
+{
+    for (int index = 0; index < stubNbOfResults; ++index) {
+        StubValue* result = &stubResults[index];
+
+        if (result->type == kTypeString) {
+            free((void*)result->bytes);
+        }
+
+        stubFreeBitmap(result->bitmap);
+    }
+
+    stubNbOfResults = 0;
+}
+
+// -- API
+
+static const struct playdate_sys stubSystem = {
+    .realloc = stubRealloc,
+    .logToConsole = stubLogToConsole,
+    .getCurrentTimeMilliseconds = stubGetCurrentTimeMilliseconds,
+    .getElapsedTime = stubGetElapsedTime
+};
+
+static const struct playdate_file stubFile = {
+    .geterr = stubGetFileError,
+    .open = stubOpenFile,
+    .close = stubCloseFile,
+    .read = stubReadFile
+};
+
+static const struct playdate_graphics stubGraphics = {
+    .setDrawOffset = stubSetDrawOffset,
+    .setClipRect = stubSetClipRect,
+    .clearClipRect = stubClearClipRect,
+    .pushContext = stubPushContext,
+    .popContext = stubPopContext,
+    .drawBitmap = stubDrawBitmap,
+    .fillRect = stubFillRect,
+    .newBitmap = stubNewBitmap,
+    .freeBitmap = stubFreeBitmap,
+    .copyBitmap = stubCopyBitmap,
+    .getBitmapData = stubGetBitmapData,
+    .loadBitmapTable = stubLoadBitmapTable,
+    .freeBitmapTable = stubFreeBitmapTable,
+    .getTableBitmap = stubGetTableBitmap,
+    .getFrame = stubGetFrame,
+    .markUpdatedRows = stubMarkUpdatedRows
+};
+
+static const struct playdate_display stubDisplay = {
+    .getWidth = stubGetDisplayWidth,
+    .getHeight = stubGetDisplayHeight
+};
+
+static const struct playdate_lua stubLua = {
+    .registerClass = stubRegisterClass,
+    .argIsNil = stubArgIsNil,
+    .getArgBool = stubGetArgBool,
+    .getArgInt = stubGetArgInt,
+    .getArgFloat = stubGetArgFloat,
+    .getArgString = stubGetArgString,
+    .getArgBytes = stubGetArgBytes,
+    .getArgObject = stubGetArgObject,
+    .pushNil = stubPushNil,
+    .pushBool = stubPushBool,
+    .pushInt = stubPushInt,
+    .pushFloat = stubPushFloat,
+    .pushBytes = stubPushBytes,
+    .pushBitmap = stubPushBitmap,
+    .pushObject = stubPushObject,
+    .retainObject = stubRetainObject,
+    .releaseObject = stubReleaseObject
+};
+
+static PlaydateAPI stubAPI = {
+    .system = &stubSystem,
+    .file = &stubFile,
+    .graphics = &stubGraphics,
+    .display = &stubDisplay,
+    .lua = &stubLua
+};
+
+PlaydateAPI* pd = &stubAPI;
+
+void* dmMemoryCalloc(size_t nb_of_items, size_t item_size)
+{
+    return calloc(nb_of_items, item_size);
+}
+
+void dmMemoryFree(void* pointer)
+{
+    free(pointer);
+}
+
+// -- Set up the stub and register the Tilemap classes.
+void stubInit(void)
+{
+    stubStartTime = stubGetTime();
+
+    stubCurrentContext = 0;
+    stubContexts[0].target = NULL;
+    stubSetDrawOffset(0, 0);
+    stubClearClipRect();
+
+    if (stubNbOfClasses == 0) {
+        register_Tilemap(pd);
+    }
+
+    stubResetCounters();
+}
+
+void stubResetCounters(void)
+{
+    memset(&stubCounters, 0, sizeof(StubCounters));
+}
+
+void stubSetMilliseconds(unsigned int milliseconds)
+{
+    stubMilliseconds = milliseconds;
+}
+
+// -- Make the tileset every Tilemap.new() loads: nb_of_tiles images of random pixels, every second one with a
+// -- random mask, from seed. Must be called before any tilemap is created since they keep pointers to the images.
+void stubSetTileset(int nb_of_tiles, int tile_width, int tile_height, unsigned int seed)
+{
+    for (int index = 0; index < stubTable.nb_of_bitmaps; ++index) {
+        stubReleaseBitmap(stubTable.bitmaps[index]);
+    }
+
+    srand(seed);
+
+    stubTable.nb_of_bitmaps = (nb_of_tiles < STUB_MAX_TILES) ? nb_of_tiles : STUB_MAX_TILES;
+    for (int index = 0; index < stubTable.nb_of_bitmaps; ++index) {
+        LCDBitmap* bitmap = stubNewBitmap(tile_width, tile_height, kColorBlack);
+        int size = bitmap->rowbytes * tile_height;
+
+        for (int i = 0; i < size; ++i) {
+            bitmap->data[i] = (uint8_t)rand();
+        }
+
+        if (index & 1) {
+            bitmap->mask = malloc(size);
+            for (int i = 0; i < size; ++i) {
+                bitmap->mask[i] = (uint8_t)(rand() | rand());
+            }
+        }
+
+        bitmap->owned_by_table = 1;
+        stubTable.bitmaps[index] = bitmap;
+    }
+}
+
+void stubClearFrame(LCDColor color)
+{
+    memset(stubFrame, (color == kColorWhite) ? 0xFF : 0x00, sizeof(stubFrame));
+}
+
+// -- Add the visible pixels of the frame buffer to an FNV-1a hash, pass 0 to start a new one.
+uint64_t stubHashFrame(uint64_t hash)
+{
+    if (hash == 0) {
+        hash = 0xCBF29CE484222325ull;
+    }
+
+    for (int row = 0; row < LCD_ROWS; ++row) {
+        const uint8_t* bytes = stubFrame + (row * LCD_ROWSIZE);
+
+        for (int i = 0; i < (LCD_COLUMNS / 8); ++i) {
+            hash ^= bytes[i];
+            hash *= 0x100000001B3ull;
+        }
+    }
+
+    return hash;
+}
+
+// -- Calling methods the way Lua would.
+
+static StubValue* stubPushArg(LuaType type)
+{
+    if (stubNbOfArgs == STUB_MAX_ARGS) {
+        fprintf(stderr, "Stub: Too many arguments.\n");
+        exit(1);
+    }
+
+    StubValue* arg = &stubArgs[stubNbOfArgs++];
+    memset(arg, 0, sizeof(StubValue));
+    arg->type = type;
+
+    return arg;
+}
+
+void stubArgObject(void* object)
+{
+    stubPushArg(kTypeObject)->object = object;
+}
+
+void stubArgInt(int value)
+{
+    stubPushArg(kTypeInt)->int_value = value;
+}
+
+void stubArgFloat(float value)
+{
+    stubPushArg(kTypeFloat)->float_value = value;
+}
+
+void stubArgBool(int value)
+{
+    stubPushArg(kTypeBool)->int_value = value;
+}
+
+void stubArgString(const char* value)
+{
+    StubValue* arg = stubPushArg(kTypeString);
+    arg->bytes = value;
+    arg->length = strlen(value);
+}
+
+void stubArgBytes(const void* bytes, size_t length)
+{
+    StubValue* arg = stubPushArg(kTypeString);
+    arg->bytes = bytes;
+    arg->length = length;
+}
+
+void stubArgNil(void)
+{
+    stubPushArg(kTypeNil);
+}
+
+// -- Call method_name of class_name with the arguments given since the last call. Returns the number of results.
+int stubCall(const char* class_name, const char* method_name)
+{
+    stubFreeResults();
+
+    for (int class_index = 0; class_index < stubNbOfClasses; ++class_index) {
+        if (strcmp(stubClasses[class_index].name, class_name) != 0) {
+            continue;
+        }
+
+        for (const lua_reg* method = stubClasses[class_index].methods; method->name != NULL; ++method) {
+            if (strcmp(method->name, method_name) == 0) {
+                int nb_of_results = method->func(NULL);
+                stubNbOfArgs = 0;
+                return nb_of_results;
+            }
+        }
+    }
+
+    fprintf(stderr, "Stub: No method %s.%s().\n", class_name, method_name);
+    exit(1);
+}
+
+// -- Return result index, 0-based, of the last call or NULL if there aren't that many.
+const StubValue* stubGetResult(int index)
+{
+    return ((index >= 0) && (index < stubNbOfResults)) ? &stubResults[index] : NULL;
+}
+
+void* stubNew(const char* class_name, const char* path)
+{
+    stubArgString(path);
+    stubCall(class_name, "new");
+
+    const StubValue* result = stubGetResult(0);
+
+    return (result != NULL) ? result->object : NULL;
+}
+
+void stubDelete(const char* class_name, void* object)
+{
+    stubArgObject(object);
+    stubCall(class_name, "__gc");
+}
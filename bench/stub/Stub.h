@@ -0,0 +1,86 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef DM_STUB_H
+#define DM_STUB_H
+
+#include "pd_api.h"
+
+// -- A 1-bit bitmap as drawn by the stub. Bit 7 of the first byte is the leftmost pixel, data bits are set for white
+// -- pixels and mask bits, when there is a mask, for opaque ones.
+struct LCDBitmap {
+    int width;
+    int height;
+    int rowbytes;
+
+    uint8_t* data;
+    uint8_t* mask;
+
+    // -- Images in the bitmap table belong to it, freeBitmap() leaves them alone like on the device.
+    int owned_by_table;
+};
+
+// -- What the code under test asked of the Playdate API since the last stubResetCounters(). Times are in
+// -- nanoseconds and include the stub's own work.
+typedef struct {
+    int nb_of_draw_bitmap_calls;
+    uint64_t draw_bitmap_time;
+
+    int nb_of_table_bitmap_calls;
+    uint64_t table_bitmap_time;
+
+    int nb_of_lua_arg_calls;
+    uint64_t lua_arg_time;
+
+    int nb_of_fill_rect_calls;
+} StubCounters;
+
+// -- A value returned to Lua by a method.
+typedef struct {
+    LuaType type;
+    int int_value;
+    float float_value;
+    const char* bytes;
+    size_t length;
+    void* object;
+
+    // -- Set for bitmaps handed over to Lua, which the stub frees with the call's other results.
+    LCDBitmap* bitmap;
+} StubValue;
+
+extern StubCounters stubCounters;
+extern uint8_t stubFrame[LCD_ROWS * LCD_ROWSIZE];
+
+extern void stubInit(void);
+extern void stubResetCounters(void);
+extern uint64_t stubGetTime(void);
+extern void stubSetMilliseconds(unsigned int milliseconds);
+
+extern void stubSetTileset(int nb_of_tiles, int tile_width, int tile_height, unsigned int seed);
+extern void stubClearFrame(LCDColor color);
+extern uint64_t stubHashFrame(uint64_t hash);
+
+extern LCDBitmap* stubNewBitmap(int width, int height, LCDColor color);
+extern void stubFreeBitmap(LCDBitmap* bitmap);
+
+extern void stubArgObject(void* object);
+extern void stubArgInt(int value);
+extern void stubArgFloat(float value);
+extern void stubArgBool(int value);
+extern void stubArgString(const char* value);
+extern void stubArgBytes(const void* bytes, size_t length);
+extern void stubArgNil(void);
+
+extern int stubCall(const char* class_name, const char* method_name);
+extern const StubValue* stubGetResult(int index);
+extern void* stubNew(const char* class_name, const char* path);
+extern void stubDelete(const char* class_name, void* object);
+
+// -- Returns 1 if pixel (x, y) of the frame buffer is white.
+static inline int stubGetFramePixel(int x, int y)
+{
+    return (stubFrame[(y * LCD_ROWSIZE) + (x >> 3)] >> (7 - (x & 7))) & 1;
+}
+
+#endif
@@ -0,0 +1,147 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+// -- Minimal stand-in for the Playdate SDK's pd_api.h, only declaring what the Tilemap sources use so they can be
+// -- built and run on a host computer. Struct layouts don't match the SDK's, nothing built with this runs on device.
+
+#ifndef PD_API_H
+#define PD_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LCD_COLUMNS 400
+#define LCD_ROWS 240
+#define LCD_ROWSIZE 52
+
+typedef struct LCDBitmap LCDBitmap;
+typedef struct LCDBitmapTable LCDBitmapTable;
+typedef struct lua_State lua_State;
+typedef struct LuaUDObject LuaUDObject;
+typedef struct SDFile SDFile;
+
+typedef uintptr_t LCDColor;
+
+typedef enum {
+    kColorBlack,
+    kColorWhite,
+    kColorClear,
+    kColorXOR
+} LCDSolidColor;
+
+typedef enum {
+    kBitmapUnflipped,
+    kBitmapFlippedX,
+    kBitmapFlippedY,
+    kBitmapFlippedXY
+} LCDBitmapFlip;
+
+typedef enum {
+    kTypeNil,
+    kTypeBool,
+    kTypeInt,
+    kTypeFloat,
+    kTypeString,
+    kTypeTable,
+    kTypeFunction,
+    kTypeThread,
+    kTypeObject
+} LuaType;
+
+typedef enum {
+    kFileRead = (1 << 0),
+    kFileReadData = (1 << 1),
+    kFileWrite = (1 << 2),
+    kFileAppend = (2 << 2)
+} FileOptions;
+
+typedef enum {
+    kEventInit,
+    kEventInitLua
+} PDSystemEvent;
+
+typedef int lua_CFunction(lua_State* L);
+
+typedef struct {
+    const char* name;
+    lua_CFunction* func;
+} lua_reg;
+
+typedef struct {
+    const char* name;
+    int type;
+    union {
+        unsigned int intval;
+        float floatval;
+        const char* strval;
+    } v;
+} lua_val;
+
+struct playdate_sys {
+    void* (*realloc)(void* ptr, size_t size);
+    void (*logToConsole)(const char* fmt, ...);
+    unsigned int (*getCurrentTimeMilliseconds)(void);
+    float (*getElapsedTime)(void);
+};
+
+struct playdate_file {
+    const char* (*geterr)(void);
+    SDFile* (*open)(const char* name, FileOptions mode);
+    int (*close)(SDFile* file);
+    int (*read)(SDFile* file, void* buf, unsigned int len);
+};
+
+struct playdate_graphics {
+    void (*setDrawOffset)(int dx, int dy);
+    void (*setClipRect)(int x, int y, int width, int height);
+    void (*clearClipRect)(void);
+    void (*pushContext)(LCDBitmap* target);
+    void (*popContext)(void);
+    void (*drawBitmap)(LCDBitmap* bitmap, int x, int y, LCDBitmapFlip flip);
+    void (*fillRect)(int x, int y, int width, int height, LCDColor color);
+    LCDBitmap* (*newBitmap)(int width, int height, LCDColor bgcolor);
+    void (*freeBitmap)(LCDBitmap* bitmap);
+    LCDBitmap* (*copyBitmap)(LCDBitmap* bitmap);
+    void (*getBitmapData)(LCDBitmap* bitmap, int* width, int* height, int* rowbytes, uint8_t** mask, uint8_t** data);
+    LCDBitmapTable* (*loadBitmapTable)(const char* path, const char** outerr);
+    void (*freeBitmapTable)(LCDBitmapTable* table);
+    LCDBitmap* (*getTableBitmap)(LCDBitmapTable* table, int idx);
+    uint8_t* (*getFrame)(void);
+    void (*markUpdatedRows)(int start, int end);
+};
+
+struct playdate_display {
+    int (*getWidth)(void);
+    int (*getHeight)(void);
+};
+
+struct playdate_lua {
+    int (*registerClass)(const char* name, const lua_reg* reg, const lua_val* vals, int isstatic, const char** outErr);
+    int (*argIsNil)(int pos);
+    int (*getArgBool)(int pos);
+    int (*getArgInt)(int pos);
+    float (*getArgFloat)(int pos);
+    const char* (*getArgString)(int pos);
+    const char* (*getArgBytes)(int pos, size_t* outlen);
+    void* (*getArgObject)(int pos, char* type, LuaUDObject** outud);
+    void (*pushNil)(void);
+    void (*pushBool)(int val);
+    void (*pushInt)(int val);
+    void (*pushFloat)(float val);
+    void (*pushBytes)(const char* str, size_t len);
+    void (*pushBitmap)(LCDBitmap* bitmap);
+    LuaUDObject* (*pushObject)(void* obj, char* type, int nValues);
+    LuaUDObject* (*retainObject)(LuaUDObject* obj);
+    void (*releaseObject)(LuaUDObject* obj);
+};
+
+typedef struct PlaydateAPI {
+    const struct playdate_sys* system;
+    const struct playdate_file* file;
+    const struct playdate_graphics* graphics;
+    const struct playdate_display* display;
+    const struct playdate_lua* lua;
+} PlaydateAPI;
+
+#endif
@@ -0,0 +1,23 @@
+// SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+//
+// SPDX-License-Identifier: MIT
+
+// -- Minimal stand-in for the pdbase toybox, providing the parts the Tilemap sources use on a host computer.
+
+#ifndef DM_PDBASE_H
+#define DM_PDBASE_H
+
+#include "pd_api.h"
+
+extern PlaydateAPI* pd;
+
+extern void* dmMemoryCalloc(size_t nb_of_items, size_t item_size);
+extern void dmMemoryFree(void* pointer);
+
+#ifdef DM_LOG_ENABLE
+#define DM_LOG(...)     pd->system->logToConsole(__VA_ARGS__)
+#else
+#define DM_LOG(...)
+#endif
+
+#endif
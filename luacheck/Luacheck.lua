@@ -16,12 +16,78 @@ return {
                     fields = {
                         new = {},
                         draw = {},
+                        asSprite = {},
+                        drawScaled = {},
+                        releaseScaledTiles = {},
                         setTileAtPosition = {},
                         getTileAtPosition = {},
+                        setTiles = {},
+                        getTiles = {},
+                        setTilesFromBytes = {},
+                        getTilesInRect = {},
+                        setTilesInRect = {},
+                        fillRect = {},
+                        copyRect = {},
                         setSize = {},
+                        loadMap = {},
+                        startLoadingMap = {},
+                        continueLoadingMap = {},
                         getSize = {},
                         getPixelSize = {},
-                        getTileSize = {}
+                        getTileSize = {},
+                        setTileSolid = {},
+                        setPassableTiles = {},
+                        setPassableTilesFromBytes = {},
+                        overlapsRect = {},
+                        getSolidRectsIn = {},
+                        getSolidRectsAsBytes = {},
+                        getCollisionRects = {},
+                        moveAndCollide = {},
+                        raycast = {},
+                        lineOfSight = {},
+                        lineOfSightFromBytes = {},
+                        setTileCost = {},
+                        findPath = {},
+                        findPathAsBytes = {},
+                        computeFlowField = {},
+                        getFlowDirection = {},
+                        setAutotileRules = {},
+                        setAutotileRulesFromBytes = {},
+                        setTerrainAt = {},
+                        getTerrainAt = {},
+                        fillTerrainRect = {},
+                        setAnimation = {},
+                        setIncrementalDraw = {},
+                        setChunkCache = {},
+                        getChunkCacheMemory = {},
+                        setDirectDraw = {},
+                        setTileAtlas = {},
+                        getTileAtlasMemory = {},
+                        getOverview = {},
+                        drawOverview = {},
+                        getOccupancyStats = {},
+                        getStats = {},
+                        getStatsAsBytes = {},
+                        resetStats = {}
+                    }
+                },
+                TilemapLayers = {
+                    fields = {
+                        new = {},
+                        addLayer = {},
+                        setLayerParallax = {},
+                        getLayerCount = {},
+                        setOcclusionCulling = {},
+                        draw = {}
+                    }
+                },
+                TilemapArena = {
+                    fields = {
+                        new = {},
+                        reset = {},
+                        getSize = {},
+                        getMemoryUsed = {},
+                        getHighWaterMark = {}
                     }
                 },
                 OldCTilemap = {
@@ -30,10 +96,19 @@ return {
                         draw = {},
                         setTileAtPosition = {},
                         getTileAtPosition = {},
+                        setTiles = {},
+                        getTiles = {},
+                        setTilesFromBytes = {},
+                        getTilesInRect = {},
+                        setTilesInRect = {},
+                        fillRect = {},
+                        copyRect = {},
                         setSize = {},
                         getSize = {},
                         getPixelSize = {},
-                        getTileSize = {}
+                        getTileSize = {},
+                        setDirectDraw = {},
+                        getOccupancyStats = {}
                     }
                 },
                 LuaTilemap = {
@@ -171,3 +171,213 @@ end
 function LuaTilemap:getTileSize()
     return self.tile_width, self.tile_height
 end
+
+-- The C tilemaps can't read Lua tables directly so their table based setTiles() and getTiles() pack the
+-- tile indices into a string, which then crosses into C in one call.
+local function packTiles(data, width)
+    local rows = {}
+    local row = {}
+    local format <const> = '<' .. string.rep('I2', width)
+    local height <const> = #data // width
+
+    for y = 0, height - 1 do
+        local offset <const> = y * width
+        for x = 1, width do
+            row[x] = data[offset + x] or 0
+        end
+
+        rows[y + 1] = string.pack(format, table.unpack(row, 1, width))
+    end
+
+    return table.concat(rows)
+end
+
+local function unpackTiles(bytes, width)
+    local data = {}
+    local format <const> = '<' .. string.rep('I2', width)
+    local position = 1
+
+    while position <= #bytes do
+        local row <const> = table.pack(string.unpack(format, bytes, position))
+        position = row[row.n]
+        table.move(row, 1, width, #data + 1, data)
+    end
+
+    return data
+end
+
+for _, class in pairs({ dm.Tilemap, dm.OldCTilemap }) do
+    -- Sets the tilemap’s width to width, then populates the tilemap with data, which should be
+    -- a flat, one-dimensional array-like table containing index values to the tilemap’s imagetable.
+    function class:setTiles(data, width)
+        self:setTilesFromBytes(packTiles(data, width), width)
+    end
+
+    -- Returns data, width
+    -- data is a flat, one-dimensional array-like table containing index values to the tilemap’s imagetable.
+    -- width is the width of the tile map, in number of tiles.
+    function class:getTiles()
+        local width <const>, height <const> = self:getSize()
+        return unpackTiles(self:getTilesInRect(1, 1, width, height), width), width
+    end
+end
+
+local drawTilemap <const> = dm.Tilemap.draw
+
+-- Draws the tile map at screen coordinate (x, y).
+-- sourceRect, if specified, will cause only the part of the tilemap within sourceRect to be drawn. Only the tiles
+-- intersecting it are visited.
+function dm.Tilemap:draw(x, y, sourceRect)
+    if sourceRect == nil then
+        drawTilemap(self, x, y)
+    else
+        drawTilemap(self, x, y, sourceRect.x, sourceRect.y, sourceRect.width, sourceRect.height)
+    end
+end
+
+-- Sprites made by asSprite(), which keep their tilemap alive but not the other way around.
+local sprites = setmetatable({}, { __mode = 'k' })
+
+-- Returns a playdate.graphics.sprite, the size of the tilemap and behind every other sprite, that draws the tilemap
+-- at its position. Only the tiles intersecting the rectangles the sprite system needs redrawn are drawn. The same
+-- sprite is returned every time. Call markDirty() on it when the tilemap's content changes.
+function dm.Tilemap:asSprite()
+    local sprite = sprites[self]
+    if sprite == nil then
+        sprite = gfx.sprite.new()
+        sprite:setCenter(0, 0)
+        sprite:moveTo(0, 0)
+        sprite:setZIndex(-32768)
+        sprite:setUpdatesEnabled(false)
+
+        local tilemap <const> = self
+        function sprite:draw(x, y, width, height)
+            -- The draw offset puts the sprite's top left corner at (0, 0) while this is called.
+            local offset_x <const>, offset_y <const> = gfx.getDrawOffset()
+            drawTilemap(tilemap, offset_x, offset_y, x, y, width, height)
+        end
+
+        sprites[self] = sprite
+    end
+
+    sprite:setSize(self:getPixelSize())
+
+    return sprite
+end
+
+local function unpackRects(bytes)
+    local rects = {}
+    local position = 1
+
+    while position < #bytes do
+        local x, y, width, height
+        x, y, width, height, position = string.unpack('<i4i4i4i4', bytes, position)
+        rects[#rects + 1] = playdate.geometry.rect.new(x, y, width, height)
+    end
+
+    return rects
+end
+
+-- Makes the image indices in ids, an array-like table, passable and every other one solid for collision queries.
+function dm.Tilemap:setPassableTiles(ids)
+    self:setPassableTilesFromBytes(string.pack('<' .. string.rep('I2', #ids), table.unpack(ids)))
+end
+
+-- Returns an array of playdate.geometry.rect, in pixels relative to the tilemap's origin, covering the solid
+-- cells overlapping the rectangle at (x, y) of size width x height.
+function dm.Tilemap:getSolidRectsIn(x, y, width, height)
+    return unpackRects(self:getSolidRectsAsBytes(x, y, width, height))
+end
+
+-- Returns an array of playdate.geometry.rect that describe the areas of the tilemap that should trigger
+-- collisions, in tilemap coordinates. emptyIDs, if specified, is an array of image indices that should be passable
+-- and replaces the tiles made passable before. Otherwise the tiles set with setPassableTiles() or setTileSolid() are
+-- used.
+function dm.Tilemap:getCollisionRects(emptyIDs)
+    if emptyIDs ~= nil then
+        self:setPassableTiles(emptyIDs)
+    end
+
+    local tile_width <const>, tile_height <const> = self:getTileSize()
+    local rects <const> = self:getSolidRectsIn(0, 0, self:getPixelSize())
+    for _, rect in ipairs(rects) do
+        rect.x = rect.x // tile_width
+        rect.y = rect.y // tile_height
+        rect.width = rect.width // tile_width
+        rect.height = rect.height // tile_height
+    end
+
+    return rects
+end
+
+-- Checks line of sight for many segments in one call. segments is a flat array-like table of (x0, y0, x1, y1)
+-- values in pixels relative to the tilemap's origin. Returns an array with one boolean per segment, true if no
+-- solid cell is in the way.
+function dm.Tilemap:lineOfSight(segments)
+    local bytes <const> = self:lineOfSightFromBytes(string.pack('<' .. string.rep('f', #segments), table.unpack(segments)))
+    local results = {}
+
+    for i = 1, #bytes do
+        results[i] = string.byte(bytes, i) == 1
+    end
+
+    return results
+end
+
+-- Finds the cheapest path from cell (startX, startY) to cell (goalX, goalY), moving diagonally as well if diagonals
+-- is true. Returns an array of playdate.geometry.point with the cells along the path, both ends included, or nil if
+-- there is no path.
+function dm.Tilemap:findPath(startX, startY, goalX, goalY, diagonals)
+    local bytes <const> = self:findPathAsBytes(startX, startY, goalX, goalY, diagonals)
+    if bytes == nil then
+        return nil
+    end
+
+    local path = {}
+    local position = 1
+
+    while position < #bytes do
+        local x, y
+        x, y, position = string.unpack('<I2I2', bytes, position)
+        path[#path + 1] = playdate.geometry.point.new(x, y)
+    end
+
+    return path
+end
+
+-- Sets the autotile rules for terrain, a number from 1 to 32, to tiles, an array-like table of 16 image indices for
+-- the 4-bit ruleset or 47 for the blob one. setTerrainAt() and fillTerrainRect() then pick each cell's image from
+-- the terrain of its neighbours (see setAutotileRulesFromBytes() for the order of the images).
+function dm.Tilemap:setAutotileRules(terrain, tiles)
+    self:setAutotileRulesFromBytes(terrain, string.pack('<' .. string.rep('I2', #tiles), table.unpack(tiles)))
+end
+
+local function unpackStats(bytes, position)
+    local stats = {}
+    stats.cellsVisited, stats.tilesDrawn, stats.tilesSkipped, stats.tilesCulled, stats.contextPushes,
+        stats.elapsedMicroseconds, position = string.unpack('<i4i4i4i4i4i4', bytes, position)
+
+    return stats, position
+end
+
+-- Returns a table with the statistics of the last draw (last), their totals since resetStats() (total), the
+-- number of draws since then (draws) and the time taken by the most recent draws in microseconds, oldest
+-- first (frameTimes). Returns nil unless the extension was built with TILEMAP_STATS_ENABLE defined.
+function dm.Tilemap:getStats()
+    local bytes <const> = self:getStatsAsBytes()
+    if bytes == nil then
+        return nil
+    end
+
+    local stats = {}
+    local position = 1
+    local nb_of_frame_times
+
+    stats.last, position = unpackStats(bytes, position)
+    stats.total, position = unpackStats(bytes, position)
+    stats.draws, nb_of_frame_times, position = string.unpack('<i4i4', bytes, position)
+    stats.frameTimes = { string.unpack('<' .. string.rep('i4', nb_of_frame_times), bytes, position) }
+    stats.frameTimes[nb_of_frame_times + 1] = nil
+
+    return stats
+end
@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+#
+# SPDX-FileCopyrightText: 2022-present Didier Malenfant <coding@malenfant.net>
+#
+# SPDX-License-Identifier: MIT
+
+"""Convert a Tiled map layer (.tmx or .json) to the binary map format read by dm.Tilemap:loadMap().
+
+usage: tiled2tilemap.py [--layer NAME] [--tileset NAME] input.tmx|input.json output.bin
+"""
+
+import argparse
+import base64
+import gzip
+import json
+import struct
+import sys
+import xml.etree.ElementTree as ElementTree
+import zlib
+
+MAP_FILE_MAGIC = b'DMTM'
+MAP_FILE_VERSION = 1
+
+# -- Tiled stores flip and rotation flags in the top bits of each global tile id.
+TILED_FLAGS_MASK = 0xF0000000
+TILED_FLIPPED_HORIZONTALLY = 0x80000000
+TILED_FLIPPED_VERTICALLY = 0x40000000
+TILED_FLIPPED_DIAGONALLY = 0x20000000
+
+# -- dm.Tilemap cells hold the image index in their low 14 bits and a playdate.graphics flip value in the top two.
+TILEMAP_INDEX_MASK = 0x3FFF
+TILEMAP_FLIPPED_X = 1 << 14
+TILEMAP_FLIPPED_Y = 2 << 14
+
+
+class ConversionError(Exception):
+    pass
+
+
+def decode_data(data, encoding, compression):
+    """Decode a Tiled layer data payload into a list of global tile ids."""
+    if encoding == 'csv':
+        return [int(value) for value in data.replace('\n', '').split(',') if value.strip() != '']
+
+    if encoding != 'base64':
+        raise ConversionError('Unsupported layer encoding \'' + str(encoding) + '\'.')
+
+    raw = base64.b64decode(data.strip())
+    if compression == 'zlib':
+        raw = zlib.decompress(raw)
+    elif compression == 'gzip':
+        raw = gzip.decompress(raw)
+    elif compression not in (None, ''):
+        raise ConversionError('Unsupported layer compression \'' + compression + '\'.')
+
+    return list(struct.unpack('<' + str(len(raw) // 4) + 'I', raw))
+
+
+def read_tmx(path, layer_name):
+    root = ElementTree.parse(path).getroot()
+    if root.get('infinite') == '1':
+        raise ConversionError('Infinite maps are not supported.')
+
+    tilesets = [(int(tileset.get('firstgid')), tileset.get('name') or tileset.get('source')) for tileset in root.findall('tileset')]
+
+    for layer in root.findall('layer'):
+        if (layer_name is not None) and (layer.get('name') != layer_name):
+            continue
+
+        width = int(layer.get('width'))
+        height = int(layer.get('height'))
+        data = layer.find('data')
+
+        encoding = data.get('encoding')
+        if encoding is None:
+            gids = [int(tile.get('gid', '0')) for tile in data.findall('tile')]
+        else:
+            gids = decode_data(data.text, encoding, data.get('compression'))
+
+        return width, height, gids, tilesets
+
+    raise ConversionError('Could not find tile layer' + ('' if layer_name is None else ' \'' + layer_name + '\'') + '.')
+
+
+def read_json(path, layer_name):
+    with open(path, 'r') as file:
+        root = json.load(file)
+
+    if root.get('infinite', False):
+        raise ConversionError('Infinite maps are not supported.')
+
+    tilesets = [(tileset['firstgid'], tileset.get('name') or tileset.get('source')) for tileset in root.get('tilesets', [])]
+
+    for layer in root.get('layers', []):
+        if layer.get('type') != 'tilelayer':
+            continue
+
+        if (layer_name is not None) and (layer.get('name') != layer_name):
+            continue
+
+        data = layer['data']
+        if isinstance(data, str):
+            gids = decode_data(data, layer.get('encoding', 'base64'), layer.get('compression'))
+        else:
+            gids = data
+
+        return layer['width'], layer['height'], gids, tilesets
+
+    raise ConversionError('Could not find tile layer' + ('' if layer_name is None else ' \'' + layer_name + '\'') + '.')
+
+
+def gids_to_indices(gids, tilesets, tileset_name):
+    """Turn Tiled global ids into 1-based indices into a single tileset's image table, 0 being empty."""
+    if len(tilesets) == 0:
+        raise ConversionError('Map has no tilesets.')
+
+    tilesets = sorted(tilesets)
+    if tileset_name is None:
+        tileset_index = 0
+    else:
+        names = [name for _, name in tilesets]
+        if tileset_name not in names:
+            raise ConversionError('Could not find tileset \'' + tileset_name + '\'.')
+
+        tileset_index = names.index(tileset_name)
+
+    first_gid = tilesets[tileset_index][0]
+    next_first_gid = tilesets[tileset_index + 1][0] if (tileset_index + 1) < len(tilesets) else None
+
+    indices = []
+    warned_about_rotation = False
+    for gid in gids:
+        flags = gid & TILED_FLAGS_MASK
+        gid &= ~TILED_FLAGS_MASK
+        if gid == 0:
+            indices.append(0)
+            continue
+
+        if (gid < first_gid) or ((next_first_gid is not None) and (gid >= next_first_gid)):
+            raise ConversionError('Tile id ' + str(gid) + ' does not belong to the selected tileset.')
+
+        index = gid - first_gid + 1
+        if index > TILEMAP_INDEX_MASK:
+            raise ConversionError('Tile index ' + str(index) + ' is too big.')
+
+        if (flags & TILED_FLIPPED_DIAGONALLY) and not warned_about_rotation:
+            print('Warning: Rotated tiles are not supported, they will only be flipped.', file=sys.stderr)
+            warned_about_rotation = True
+
+        if flags & TILED_FLIPPED_HORIZONTALLY:
+            index |= TILEMAP_FLIPPED_X
+
+        if flags & TILED_FLIPPED_VERTICALLY:
+            index |= TILEMAP_FLIPPED_Y
+
+        indices.append(index)
+
+    return indices
+
+
+def write_map(path, width, height, indices):
+    if len(indices) != width * height:
+        raise ConversionError('Layer has ' + str(len(indices)) + ' cells, expected ' + str(width * height) + '.')
+
+    with open(path, 'wb') as file:
+        file.write(MAP_FILE_MAGIC)
+        file.write(struct.pack('<HHII', MAP_FILE_VERSION, 0, width, height))
+        file.write(struct.pack('<' + str(len(indices)) + 'H', *indices))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert a Tiled map layer to a dm.Tilemap binary map file.')
+    parser.add_argument('--layer', help='name of the tile layer to convert, defaults to the first one')
+    parser.add_argument('--tileset', help='name of the tileset the layer uses, defaults to the first one')
+    parser.add_argument('input', help='Tiled map (.tmx or .json)')
+    parser.add_argument('output', help='binary map file to write')
+    arguments = parser.parse_args()
+
+    try:
+        if arguments.input.endswith('.tmx'):
+            width, height, gids, tilesets = read_tmx(arguments.input, arguments.layer)
+        else:
+            width, height, gids, tilesets = read_json(arguments.input, arguments.layer)
+
+        write_map(arguments.output, width, height, gids_to_indices(gids, tilesets, arguments.tileset))
+    except (ConversionError, OSError, ValueError, KeyError, zlib.error) as error:
+        print('tiled2tilemap: ' + str(error), file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()